@@ -18,6 +18,8 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <EEPROM.h>
+
 #include "hw_config.h"
 #include "constants.h"
 #include "layout_config_FI.h"
@@ -34,11 +36,33 @@ bool modifier_pressed_before_non_a_modifier_key = false;
 //Keeps the states of all switches
 struct State states[ROWS][COLUMNS] = {0};
 
+// Bounce statistics of all switches
+struct SwitchStats switch_stats[ROWS][COLUMNS] = {0};
+bool switch_tuning_changed = false; // True if there is something to save to the EEPROM
+unsigned long switch_tuning_saved_time = 0;
+int16_t switch_stats_export_index = -1; // Next switch to export, -1 if not exporting
+
 // First byte is for storing active modifier keys.
 // Other bytes store all currently pressed keys -> max 6 keys can be pressed simultaneously.
 // Value of the byte is equal to the key code of the pressed key.
 uint8_t active_key_regiser[7] = {0x00};
 
+// Media and system keys, these are sent separately from the other keys.
+struct MediaKey media_keys[MEDIA_KEY_SLOTS] = {0};
+uint8_t active_media_keys = 0; // Number of used slots in the media_keys array
+
+#ifdef MOUSE_KEYS
+// Mouse actions that are currently pressed (MOUSE_BIT).
+uint16_t mouse_keys = 0;
+
+unsigned long mouse_report_time = 0; // us, time of the next mouse report
+unsigned long mouse_move_time = 0;   // ms, time when the movement started
+unsigned long mouse_scroll_time = 0; // ms, time when the scrolling started
+
+// Movement that has not been sent yet, in 1/256 pixels (or scroll steps).
+int32_t mouse_remainder[4] = {0}; // x, y, wheel, horizontal wheel
+#endif
+
 // To keep track of the state of FN-lock
 bool fn_lock_is_on = false;
 
@@ -48,11 +72,40 @@ unsigned long last_action_time = 0;
 // State of the keyboard (i.e. current layer).
 CurrentLayer keyboard_layer = L1;
 
+// Switches used in combos, one mask for each layer (index: keyboard_layer / 2).
+uint32_t combo_switches[2][SWITCH_MASK_WORDS] = {{0}};
+
+// Switches that are held back until the combo engine has resolved them.
+uint32_t combo_pending_switches[SWITCH_MASK_WORDS] = {0};
+bool combo_is_pending = false;
+unsigned long combo_pending_time = 0; // Time when the first held switch was pressed.
+
+// Number of combos whose action is currently being sent.
+uint8_t active_combos = 0;
+
+#ifdef DEBUG_LOG
+// Ring buffer for the debug log, written in the main loop and sent to the serial port when the keyboard is idle.
+struct LogRecord debug_log[DEBUG_LOG_SIZE];
+uint8_t debug_log_head = 0; // Next record to write
+uint8_t debug_log_tail = 0; // Next record to send
+uint32_t debug_log_dropped = 0; // Records lost because the buffer was full
+#endif
+
+#ifdef USAGE_COUNTERS
+// Number of presses of each action of each key, same order as keys_const[].key_code.
+uint32_t key_usage[NUMBER_OF_KEYS][4] = {{0}};
+uint16_t key_usage_layout_id = 0;   // Checksum of the layout, the saved counters are dropped if it changes
+uint16_t key_usage_bank_size = 0;   // Bytes per EEPROM bank
+uint8_t key_usage_banks = 0;        // Number of EEPROM banks, 0 if the EEPROM is too small
+uint8_t key_usage_bank = 0;         // EEPROM bank of the latest save
+uint16_t key_usage_sequence = 0;    // Sequence number of the latest save
+unsigned long key_usage_saved_time = 0;
+int16_t key_usage_export_index = -1; // Next key to export, -1 if not exporting
+#endif
+
 void setup() {
-  // For debugging:
-#if defined DEBUG_PRINT_STATES_ARRAY || defined DEBUG_PRINT
+  // For debugging and the exports (see process_serial_commands()):
   Serial.begin(9600);
-#endif
 
   // Initialize array
   for (int x = 0; x < 10; x++) {
@@ -80,6 +133,11 @@ void setup() {
   pinMode(LED2, OUTPUT);
 
   initialize_keys_list();
+  initialize_combos();
+  load_switch_tuning();
+#ifdef USAGE_COUNTERS
+  load_usage_counters();
+#endif
 }
 
 void initialize_keys_list() {
@@ -106,12 +164,21 @@ void loop() {
   
   set_fn_lock();
   set_current_layer();
+  process_combos();
   send_keys();
   release_keys();
+  send_media_keys();
+#ifdef MOUSE_KEYS
+  send_mouse();
+#endif
   
   update_key_state();
   update_last_state();
   set_leds();
+  save_switch_tuning();
+#ifdef USAGE_COUNTERS
+  save_usage_counters();
+#endif
   set_sleep_mode();
 
 #ifdef DEBUG_PRINT
@@ -119,25 +186,28 @@ void loop() {
   static uint8_t active_key_regiser_last[7] = {0x00};
 
   if (memcmp(active_key_regiser,active_key_regiser_last,7) != 0){
-    // Print if register has changed
-
-    for(int i = 0; i < 8; i++){
-      Serial.print(0x1 & (active_key_regiser[0]>>i));
-    }
-    Serial.print("\t");
-
-    for(int i = 1; i<7; i++){
-      Serial.print(active_key_regiser[i]);
-      Serial.print("\t");
-    }
-    
-    Serial.println("");
+    // Log if register has changed
+    LOG_EVENT(LOG_KEY_REGISTER, active_key_regiser[0],
+      active_key_regiser[1] | (active_key_regiser[2] << 8),
+      active_key_regiser[3] | (active_key_regiser[4] << 8),
+      active_key_regiser[5] | (active_key_regiser[6] << 8));
   }
   
   // Copy for next round
   memcpy(active_key_regiser_last,active_key_regiser,7);
 #endif
 
+  process_serial_commands();
+  export_switch_stats();
+
+#ifdef DEBUG_LOG
+  send_debug_log();
+#endif
+
+#ifdef USAGE_COUNTERS
+  export_usage_counters();
+#endif
+
   //Serial.println(micros() - t);
   //delay(50);
 
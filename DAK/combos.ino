@@ -0,0 +1,295 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    combos.ino - triggers actions when several switches are pressed together (combos).
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Combos are matched using switch masks (one bit per switch of the states array).
+The presses of switches that are part of a combo are held back in read_switches()
+and collected to combo_pending_switches. The pending switches are then compared
+to the mask of each combo with a few word operations. Once the combo has been
+resolved, the held switches are added to the states array: either as a triggered
+combo (the keys of the switches are disabled) or as normal key strokes.
+*/
+
+void initialize_combos() {
+  // Compute the switch masks of all combos and the masks of all switches used in combos on each layer.
+
+  for (uint8_t k = 0; k < NUMBER_OF_COMBOS; k++) {
+    uint8_t n = combos_const[k].number_of_switches;
+    if (n > COMBO_MAX_SWITCHES) {
+      n = COMBO_MAX_SWITCHES;
+    }
+
+    for (uint8_t s = 0; s < n; s++) {
+      uint8_t c = combos_const[k].switches[s].c;
+      uint8_t r = combos_const[k].switches[s].r;
+
+      SWITCH_MASK_SET(combos[k].mask, r, c);
+
+      // The 2. switch of a key can't be pressed without pressing the 1. switch, thus, it is added to the combo as well.
+      for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+        if (keys_const[i].second_switch_pos.r == r && keys_const[i].second_switch_pos.c == c && key_uses_switch(i, r, c)) {
+          SWITCH_MASK_SET(combos[k].mask, keys_const[i].first_switch_pos.r, keys_const[i].first_switch_pos.c);
+        }
+      }
+    }
+
+    for (uint8_t w = 0; w < SWITCH_MASK_WORDS; w++) {
+      combo_switches[combos_const[k].layer >> 1][w] |= combos[k].mask[w];
+    }
+  }
+}
+
+// Called by read_switches() when a switch has been in a constant state for its debounce time.
+// Returns true if the change is held back, because the switch might be a part of a combo.
+// A held switch stays in the bounce filter of read_switches(), thus, pin_state == 0 is a debounced release.
+bool hold_switch_for_combo(uint8_t r, uint8_t c, uint8_t pin_state) {
+
+  if (NUMBER_OF_COMBOS == 0) {
+    return false;
+  }
+
+  if (combo_is_pending && SWITCH_MASK_GET(combo_pending_switches, r, c)) {
+    if (pin_state == 0) {
+      // The switch was released before the combo was completed -> send the held switches as normal key strokes.
+      flush_pending_combo_switches();
+    }
+    states[r][c].switch_bounce_time = 0;
+    return true;
+  }
+
+  if (pin_state == 0 || states[r][c].state == 1) {
+    return false;
+  }
+
+  if (!SWITCH_MASK_GET(combo_switches[keyboard_layer >> 1], r, c)) {
+    // Not part of any combo -> no delay, but the held switches have to be sent first to keep the order of the key strokes.
+    // send_keys() goes through the keys in the order of the layout, thus, this switch is added on the next loop
+    // (its change stays in the bounce filter).
+    if (combo_is_pending) {
+      flush_pending_combo_switches();
+      return true;
+    }
+    return false;
+  }
+
+  if (!combo_is_pending) {
+    combo_is_pending = true;
+    combo_pending_time = millis();
+  }
+  SWITCH_MASK_SET(combo_pending_switches, r, c);
+  last_action_time = millis();
+  add_switch_press(r, c, last_action_time - states[r][c].switch_state_changed_time);
+  states[r][c].switch_bounce_time = 0;
+
+  return true;
+}
+
+// Adds all held switches to the states array as pressed.
+void flush_pending_combo_switches() {
+
+  for (uint8_t w = 0; w < SWITCH_MASK_WORDS; w++) {
+    while (combo_pending_switches[w] != 0) {
+      uint8_t bit = __builtin_ctz(combo_pending_switches[w]);
+      combo_pending_switches[w] &= combo_pending_switches[w] - 1; // Clear lowest bit
+
+      uint8_t r = (w * 32 + bit) / COLUMNS;
+      uint8_t c = (w * 32 + bit) % COLUMNS;
+
+      states[r][c].state = 1;
+      states[r][c].switch_bounce_time = 0;
+      states[r][c].switch_state_changed_time = combo_pending_time; // DELAY_TIME of DOUBLE_ACTION keys is counted from the first press
+
+#ifdef DEBUG_PRINT_STATES_ARRAY
+      LOG_EVENT(LOG_SWITCH_CHANGED, 1, r, c, 0);
+#endif
+    }
+  }
+  combo_is_pending = false;
+}
+
+void process_combos() {
+
+  if (active_combos > 0) {
+    release_combos();
+  }
+
+  if (!combo_is_pending) {
+    return;
+  }
+
+  int8_t best = -1;         // Combo with most switches that is completely pressed
+  uint8_t best_size = 0;
+  bool can_grow = false;    // True if a combo with more switches could still be completed
+  uint16_t term = 0;
+
+  for (uint8_t k = 0; k < NUMBER_OF_COMBOS; k++) {
+
+    if (combos_const[k].layer != keyboard_layer || combos[k].active) {
+      continue;
+    }
+
+    bool combo_is_pressed = true;   // all switches of the combo are pending
+    bool pending_in_combo = true;   // all pending switches belong to the combo
+    uint8_t size = 0;
+
+    for (uint8_t w = 0; w < SWITCH_MASK_WORDS; w++) {
+      size += __builtin_popcount(combos[k].mask[w]);
+
+      if (combos[k].mask[w] & ~combo_pending_switches[w]) {
+        combo_is_pressed = false;
+      }
+      if (combo_pending_switches[w] & ~combos[k].mask[w]) {
+        pending_in_combo = false;
+      }
+    }
+
+    if (combo_is_pressed && size > best_size) {
+      best = k;
+      best_size = size;
+    } else if (pending_in_combo && !combo_is_pressed) {
+      can_grow = true;
+      if (combos_const[k].term > term) {
+        term = combos_const[k].term;
+      }
+    }
+  }
+
+  if (can_grow && millis() - combo_pending_time < term) {
+    return; // Wait for the rest of the switches
+  }
+
+  if (best != -1) {
+    trigger_combo(best);
+  }
+
+  // Send switches that did not belong to the triggered combo as normal key strokes.
+  flush_pending_combo_switches();
+}
+
+// Returns true if key i uses the switch in the position r, c.
+bool key_uses_switch(uint8_t i, uint8_t r, uint8_t c) {
+
+  if (keys_const[i].first_switch_pos.r == r && keys_const[i].first_switch_pos.c == c) {
+    return true;
+  }
+
+  // Keys with only one switch refer to {0,0} as the second switch, thus, it is only used if there is a 2. action.
+  return keys_const[i].second_switch_pos.r == r && keys_const[i].second_switch_pos.c == c &&
+    (keys_const[i].key_code[1] | keys_const[i].modifier_code[1] | keys_const[i].key_code[3] | keys_const[i].modifier_code[3]) != 0;
+}
+
+void trigger_combo(uint8_t k) {
+
+  // Add the switches to the states array and disable their keys, so that
+  // the switches don't send their own actions. The keys are enabled again once released.
+  for (uint8_t w = 0; w < SWITCH_MASK_WORDS; w++) {
+    uint32_t mask = combos[k].mask[w];
+
+    while (mask != 0) {
+      uint8_t bit = __builtin_ctz(mask);
+      mask &= mask - 1; // Clear lowest bit
+
+      uint8_t r = (w * 32 + bit) / COLUMNS;
+      uint8_t c = (w * 32 + bit) % COLUMNS;
+
+      states[r][c].state = 1;
+      states[r][c].switch_bounce_time = 0;
+      states[r][c].switch_state_changed_time = combo_pending_time;
+
+#ifdef DEBUG_PRINT_STATES_ARRAY
+      LOG_EVENT(LOG_SWITCH_CHANGED, 1, r, c, 0);
+#endif
+
+      for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+        if (key_uses_switch(i, r, c)) {
+          keys[i].state = DISABLED;
+        }
+      }
+    }
+    combo_pending_switches[w] &= ~combos[k].mask[w];
+  }
+
+  combos[k].active = true;
+  active_combos++;
+
+  SET_MODIFIER(combos_const[k].modifier_code);
+
+  if (IS_MEDIA_OR_SYSTEM_CODE(combos_const[k].key_code)) {
+    press_media_key(combos_const[k].key_code);
+  } else {
+    combos[k].active_key_position = register_key_code(combos_const[k].key_code);
+    Keyboard.send_now();
+  }
+
+#ifdef DEBUG_PRINT
+  LOG_EVENT(LOG_COMBO_TRIGGERED, k, 0, 0, 0);
+#endif
+}
+
+void release_combo(uint8_t k) {
+
+  combos[k].active = false;
+  active_combos--;
+
+  RELEASE_MODIFIER(combos_const[k].modifier_code);
+  reactivate_locked_modifiers(-1);
+
+  if (IS_MEDIA_OR_SYSTEM_CODE(combos_const[k].key_code)) {
+    release_media_key(combos_const[k].key_code);
+  } else {
+    if (combos[k].active_key_position != 0) {
+      unregister_key_code(combos[k].active_key_position);
+      combos[k].active_key_position = 0;
+    }
+    Keyboard.send_now();
+  }
+}
+
+// Releases the action of a combo once any of its switches is released.
+void release_combos() {
+
+  for (uint8_t k = 0; k < NUMBER_OF_COMBOS; k++) {
+
+    if (!combos[k].active) {
+      continue;
+    }
+
+    for (uint8_t s = 0; s < combos_const[k].number_of_switches && s < COMBO_MAX_SWITCHES; s++) {
+      if (states[combos_const[k].switches[s].r][combos_const[k].switches[s].c].state == 0) {
+        release_combo(k);
+        break;
+      }
+    }
+  }
+}
+
+// Used when the layer is changed.
+void reset_combos() {
+
+  for (uint8_t k = 0; k < NUMBER_OF_COMBOS; k++) {
+    if (combos[k].active) {
+      release_combo(k);
+    }
+  }
+
+  if (combo_is_pending) {
+    flush_pending_combo_switches();
+  }
+}
@@ -22,10 +22,43 @@
 #define CONSTANTS
 
 #define DELAY_TIME          400     //ms      Defines how long the first layer needs to be pressed before the keystroke is sent.
-#define DELAY_TIME_BOUNCE   60      //*0.1 ms Used to avoid double clicks. If double clicks occur increase this value.
+#define DELAY_TIME_BOUNCE   60      //*0.1 ms Initial debounce time of each switch, it is tuned automatically between the two limits below.
+#define BOUNCE_TIME_MIN     20      //*0.1 ms Shortest debounce time of a switch.
+#define BOUNCE_TIME_MAX     170     //*0.1 ms Longest debounce time of a switch, if double clicks occur increase this value.
+#define BOUNCE_TIME_STEP    ((BOUNCE_TIME_MAX - BOUNCE_TIME_MIN) / 15) // Debounce times are stored in 4 bits, thus, 16 levels.
+#define BOUNCE_TUNE_PRESSES 64      //        Number of presses after which the debounce time of a switch can be decreased by one step.
+#define CHATTER_WINDOWS     2       //        Releases shorter than this many debounce times of the switch are counted as chatter (double clicks that were not filtered).
+#define SWITCH_TUNING_SAVE_INTERVAL 600000 //ms Minimum time between saving the debounce times and statistics to the EEPROM.
+#define USAGE_SAVE_INTERVAL 1800000 //ms     Minimum time between saving the usage counters to the EEPROM.
+#define USAGE_BANKS_MAX     4       //        The usage counters are saved to EEPROM banks in turns (wear leveling), max this many banks.
 #define DELAY_SLEEP_MODE    10000   //ms      Time after the keyboard goes to sleep mode.
 #define SLEEP_DELAY_TIME    10      //ms      Delay that is added in sleep mode to each loop. To disable the sleep mode, set this value to zero.
 
+#define MEDIA_KEY_SLOTS       4     //        Maximum number of media/system keys pressed at the same time.
+#define MEDIA_REPEAT_DELAY    400   //ms      Time a repeating media key (e.g., volume) needs to be held before it is repeated.
+#define MEDIA_REPEAT_INTERVAL 100   //ms      Time between the repeats of a held media key.
+
+#define MOUSE_REPORT_INTERVAL 1000  //us      Time between mouse reports (1000 us -> 1 kHz), movement does not depend on the loop time.
+#define MOUSE_CURVE_STEP      200   //ms      Time between the points of the mouse acceleration curves (see layout_config_FI.h).
+
+#define COMBO_MAX_SWITCHES  4       //        Maximum number of switches in one combo (see layout_config_FI.h).
+
+#define DEBUG_LOG_SIZE      128     //        Number of records in the debug log, must be a power of two (max 256).
+#define DEBUG_LOG_IDLE_TIME 20      //ms      The debug log is sent to the serial port only when no switch has changed for this time.
+#define SERIAL_LINE_MAX     64      //bytes   The exports (process_serial_commands()) send one line per loop when the serial port has room for this many bytes.
+
+// The debug log is used by both debug modes (see hw_config.h).
+#if defined DEBUG_PRINT_STATES_ARRAY || defined DEBUG_PRINT
+#define DEBUG_LOG
+#endif
+
+// Adds a record to the debug log, does nothing if the debug log is not in use.
+#ifdef DEBUG_LOG
+#define LOG_EVENT(event, arg, a0, a1, a2) debug_log_write(event, arg, a0, a1, a2)
+#else
+#define LOG_EVENT(event, arg, a0, a1, a2)
+#endif
+
 // Used for setting FN lock and testing if FN layer is active.
 #define FN1_ROW FN1[1]
 #define FN1_COL FN1[0]
@@ -36,7 +69,48 @@
 #define FN_KEYS_ARE_PUSHED      (states[FN1_ROW][FN1_COL].state == 1 && states[FN2_ROW][FN2_COL].state == 1 && (states[FN2_ROW][FN2_COL].last_state != states[FN2_ROW][FN2_COL].state || states[FN1_ROW][FN1_COL].state != states[FN1_ROW][FN1_COL].last_state))
 
 // Checks if the key code of a key is a media key or a system key
-#define KEY_MEDIA_OR_KEY_SYSTEM(layer) ((keys_const[i].key_code[layer] & 0xFF00) == 0xE400 ||(keys_const[i].key_code[layer] & 0xFF00) == 0xE200)
+#define IS_MEDIA_OR_SYSTEM_CODE(code)  (((code) & 0xFF00) == 0xE400 || ((code) & 0xFF00) == 0xE200)
+#define KEY_MEDIA_OR_KEY_SYSTEM(layer) IS_MEDIA_OR_SYSTEM_CODE(keys_const[i].key_code[layer])
+
+// Media keys that are repeated by the firmware while held (see media_keys.ino).
+#define MEDIA_KEY_REPEATS(code) ((code) == KEY_MEDIA_VOLUME_INC || (code) == KEY_MEDIA_VOLUME_DEC)
+
+// EEPROM addresses. The statistics are only saved if the EEPROM is large enough (e.g., not on Teensy-LC).
+#define EEPROM_SWITCH_TUNING_MAGIC  0xD1  // Changed if the format of the saved data changes
+#define EEPROM_SWITCH_TUNING        0     // Magic byte + debounce time of each switch (4 bits per switch)
+#define EEPROM_SWITCH_STATS         (EEPROM_SWITCH_TUNING + 1 + (ROWS * COLUMNS + 1) / 2)
+#define EEPROM_SWITCH_STATS_END     (EEPROM_SWITCH_STATS + ROWS * COLUMNS * 4)
+#define EEPROM_USAGE_COUNTERS       EEPROM_SWITCH_STATS_END // Banks of usage counters, as many as fit (see usage.ino)
+
+// Mouse actions, these can be used as key codes (requires MOUSE_KEYS, see hw_config.h).
+#define MOUSE_MOVE_UP         0xD000
+#define MOUSE_MOVE_DOWN       0xD001
+#define MOUSE_MOVE_LEFT       0xD002
+#define MOUSE_MOVE_RIGHT      0xD003
+#define MOUSE_SCROLL_UP       0xD004
+#define MOUSE_SCROLL_DOWN     0xD005
+#define MOUSE_SCROLL_LEFT     0xD006
+#define MOUSE_SCROLL_RIGHT    0xD007
+#define MOUSE_CLICK_LEFT      0xD008
+#define MOUSE_CLICK_RIGHT     0xD009
+#define MOUSE_CLICK_MIDDLE    0xD00A
+
+// Checks if the key code of a key is a mouse action
+#define IS_MOUSE_CODE(code)   (((code) & 0xFF00) == 0xD000)
+#define KEY_MOUSE(layer)      IS_MOUSE_CODE(keys_const[i].key_code[layer])
+
+// Bits of the mouse_keys variable
+#define MOUSE_BIT(code)       (1 << ((code) & 0x0F))
+#define MOUSE_MOVE_BITS       (MOUSE_BIT(MOUSE_MOVE_UP) | MOUSE_BIT(MOUSE_MOVE_DOWN) | MOUSE_BIT(MOUSE_MOVE_LEFT) | MOUSE_BIT(MOUSE_MOVE_RIGHT))
+#define MOUSE_SCROLL_BITS     (MOUSE_BIT(MOUSE_SCROLL_UP) | MOUSE_BIT(MOUSE_SCROLL_DOWN) | MOUSE_BIT(MOUSE_SCROLL_LEFT) | MOUSE_BIT(MOUSE_SCROLL_RIGHT))
+
+// Switch masks store one bit per switch of the states array, packed into 32-bit words.
+// They are used by the combo engine to compare sets of switches with a few word operations.
+#define SWITCH_MASK_WORDS             ((ROWS * COLUMNS + 31) / 32)
+#define SWITCH_INDEX(r, c)            ((r) * COLUMNS + (c))
+#define SWITCH_MASK_GET(mask, r, c)   (((mask)[SWITCH_INDEX(r, c) >> 5] >> (SWITCH_INDEX(r, c) & 31)) & 1UL)
+#define SWITCH_MASK_SET(mask, r, c)   (mask)[SWITCH_INDEX(r, c) >> 5] |=  (1UL << (SWITCH_INDEX(r, c) & 31))
+#define SWITCH_MASK_CLEAR(mask, r, c) (mask)[SWITCH_INDEX(r, c) >> 5] &= ~(1UL << (SWITCH_INDEX(r, c) & 31))
 
 #define SET_MODIFIER(mod)      active_key_regiser[0] |=  mod; Keyboard.set_modifier(active_key_regiser[0]);
 #define RELEASE_MODIFIER(mod)  active_key_regiser[0] &= ~mod; Keyboard.set_modifier(active_key_regiser[0]);
@@ -83,6 +157,17 @@ typedef enum key_state {
 } KeyState;
 
 
+// Events of the debug log. The same ids are used by tools/decode_debug_log.py
+typedef enum log_event {
+  LOG_DROPPED = 0,            // a0, a1: number of dropped records (low, high 16 bits)
+  LOG_SWITCH_CHANGED = 1,     // arg: state, a0: row, a1: column
+  LOG_KEY_REGISTER = 2,       // arg: modifiers, a0-a2: keys 1-6 (two keys in each)
+  LOG_MEDIA_KEY_PRESSED = 3,  // a0: key code
+  LOG_MEDIA_KEY_RELEASED = 4, // a0: key code
+  LOG_LAYER_CHANGED = 5,      // arg: layer
+  LOG_COMBO_TRIGGERED = 6,    // arg: index of the combo
+} __attribute__((packed)) LogEvent;
+
 // Key types used to define the behavior a key.
 typedef enum key_type {
   ADDITIVE_ACTION,
@@ -101,6 +186,9 @@ struct Rc {
   uint8_t r; // row
 }__attribute__((packed));
 
+// Value of Key.active_key_position for a pressed action that has no place in the active_key_register.
+#define ACTION_ACTIVE 0xFF
+
 // Stores all not constant information of one key.
 struct Key {
 
@@ -108,6 +196,7 @@ struct Key {
   bool double_press;
 
   // Stores the place of the pressed key in the active_key_register, each layer has one cell.
+  // ACTION_ACTIVE if the action is pressed but has no place (media, mouse and modifier actions).
   uint8_t active_key_position[4];
 
   KeyConfig config_layer[4]; // config of each layer (is it a modifier or not)
@@ -132,6 +221,56 @@ struct KeyConst {
 
 }__attribute__((packed));
 
+// Stores all constant information of one combo (several switches pressed together).
+struct ComboConst {
+
+  CurrentLayer layer;     // Layer on which the combo is active (L1 or L2)
+  uint16_t term;          // ms, all switches of the combo need to be pressed within this time
+
+  uint16_t key_code;      // Key code sent when the combo is triggered
+  uint16_t modifier_code; // Modifiers sent when the combo is triggered
+
+  uint8_t number_of_switches;
+  struct Rc switches[COMBO_MAX_SWITCHES];
+
+}__attribute__((packed));
+
+// Stores all not constant information of one combo.
+struct Combo {
+
+  // Bit mask of the switches of the combo, computed from ComboConst.switches at start-up.
+  uint32_t mask[SWITCH_MASK_WORDS];
+
+  bool active; // True while the combo action is being sent.
+
+  // Stores the place of the combo key in the active_key_register.
+  uint8_t active_key_position;
+
+};
+
+// One record of the debug log. Sent to the serial port as is, after a sync byte.
+struct LogRecord {
+
+  uint32_t time; // us
+  LogEvent event;
+  uint8_t arg;
+  uint16_t args[3];
+
+}__attribute__((packed));
+
+// Stores the state of one pressed media or system key.
+struct MediaKey {
+
+  uint16_t key_code; // 0 = free
+
+  bool held;    // The key is held down on the keyboard
+  bool pressed; // A press that has not been sent yet
+  bool sent;    // The press has been sent to the host
+
+  uint32_t repeat_time; // ms, time of the next repeat
+
+};
+
 // Stores the state of one switch in the states array.
 struct State {
   
@@ -144,6 +283,22 @@ struct State {
   // Used to filter bouncing.
   uint32_t switch_bounce_time;
 
+  // Debounce time of the switch (*0.1 ms), tuned by the firmware.
+  uint8_t debounce_time;
+
+}__attribute__((packed));
+
+// Bounce statistics of one switch, used for tuning the debounce time.
+struct SwitchStats {
+
+  uint16_t bounces;  // Number of filtered bounces
+  uint16_t chatters; // Number of bounces that were not filtered (CHATTER_WINDOWS)
+  uint8_t bounce_max; // *0.1 ms, longest filtered bounce
+
+  // Used to decrease the debounce time after BOUNCE_TUNE_PRESSES.
+  uint8_t period_bounce_max; // *0.1 ms, longest bounce of the current period
+  uint8_t period_presses;
+
 }__attribute__((packed));
 
 #endif
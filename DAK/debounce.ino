@@ -0,0 +1,209 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    debounce.ino - collects bounce statistics of each switch and tunes the debounce times.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Each switch has its own debounce time (states[r][c].debounce_time). A bounce is
+a change of the switch that is shorter than the debounce time, it is filtered by
+read_switches(). The debounce time is kept at least twice as long as the longest
+bounce, and it is doubled if a release shorter than CHATTER_WINDOWS debounce
+times gets through (i.e., a double click). If the bounces stay short, the debounce time is decreased
+by one step every BOUNCE_TUNE_PRESSES presses. Thus, healthy switches run with
+BOUNCE_TIME_MIN and only worn switches get longer debounce times.
+
+The debounce times are stored in 4 bit levels: BOUNCE_TIME_MIN + level * BOUNCE_TIME_STEP.
+*/
+
+// Returns the shortest debounce time level that is at least the given time (*0.1 ms).
+uint8_t debounce_level(uint16_t time) {
+  if (time <= BOUNCE_TIME_MIN) {
+    return 0;
+  }
+  uint16_t level = (time - BOUNCE_TIME_MIN + BOUNCE_TIME_STEP - 1) / BOUNCE_TIME_STEP;
+  return level > 15 ? 15 : level;
+}
+
+uint8_t debounce_time_of_level(uint8_t level) {
+  return BOUNCE_TIME_MIN + level * BOUNCE_TIME_STEP;
+}
+
+void set_debounce_time(uint8_t r, uint8_t c, uint16_t time) {
+  uint8_t debounce_time = debounce_time_of_level(debounce_level(time));
+
+  if (debounce_time != states[r][c].debounce_time) {
+    states[r][c].debounce_time = debounce_time;
+    switch_tuning_changed = true;
+  }
+}
+
+// Called by read_switches() when a bounce has been filtered, duration in 0.1 ms.
+void add_switch_bounce(uint8_t r, uint8_t c, uint32_t duration) {
+  struct SwitchStats *stats = &switch_stats[r][c];
+
+  if (duration > 255) {
+    duration = 255;
+  }
+
+  if (stats->bounces < 0xFFFF) {
+    stats->bounces++;
+  }
+  if (duration > stats->bounce_max) {
+    stats->bounce_max = duration;
+  }
+  if (duration > stats->period_bounce_max) {
+    stats->period_bounce_max = duration;
+  }
+  switch_tuning_changed = true;
+
+  // Bounce was close to the debounce time -> increase it right away.
+  if (2 * duration > states[r][c].debounce_time) {
+    set_debounce_time(r, c, 2 * duration);
+  }
+}
+
+// Called by read_switches() when a press is added to the states array,
+// release_time (ms) is the time the switch was released before the press.
+void add_switch_press(uint8_t r, uint8_t c, uint32_t release_time) {
+  struct SwitchStats *stats = &switch_stats[r][c];
+
+  if (release_time * 10 < CHATTER_WINDOWS * states[r][c].debounce_time) {
+    // Most likely a bounce that was longer than the debounce time. A release of a
+    // bounce-free switch (e.g., a double letter) takes longer even when typing fast.
+    if (stats->chatters < 0xFFFF) {
+      stats->chatters++;
+    }
+    switch_tuning_changed = true;
+
+    set_debounce_time(r, c, 2 * states[r][c].debounce_time);
+    stats->period_presses = 0;
+    return;
+  }
+
+  if (++stats->period_presses < BOUNCE_TUNE_PRESSES) {
+    return;
+  }
+
+  // End of period -> decrease the debounce time by one step if the bounces have been short.
+  if (2 * stats->period_bounce_max < states[r][c].debounce_time - BOUNCE_TIME_STEP) {
+    set_debounce_time(r, c, states[r][c].debounce_time - BOUNCE_TIME_STEP);
+  }
+  stats->period_presses = 0;
+  stats->period_bounce_max = 0;
+}
+
+void load_switch_tuning() {
+
+  bool saved = EEPROM.read(EEPROM_SWITCH_TUNING) == EEPROM_SWITCH_TUNING_MAGIC;
+
+  for (uint8_t r = 0; r < ROWS; r++) {
+    for (uint8_t c = 0; c < COLUMNS; c++) {
+      uint16_t n = SWITCH_INDEX(r, c);
+
+      if (!saved) {
+        states[r][c].debounce_time = debounce_time_of_level(debounce_level(DELAY_TIME_BOUNCE));
+        continue;
+      }
+
+      uint8_t levels = EEPROM.read(EEPROM_SWITCH_TUNING + 1 + n / 2);
+      states[r][c].debounce_time = debounce_time_of_level(n % 2 ? levels >> 4 : levels & 0x0F);
+
+#if E2END + 1 >= EEPROM_SWITCH_STATS_END
+      int address = EEPROM_SWITCH_STATS + n * 4;
+      switch_stats[r][c].bounces = EEPROM.read(address) | (EEPROM.read(address + 1) << 8);
+      switch_stats[r][c].chatters = EEPROM.read(address + 2);
+      switch_stats[r][c].bounce_max = EEPROM.read(address + 3);
+#endif
+    }
+  }
+  switch_tuning_saved_time = millis();
+}
+
+// Saves the debounce times and the statistics when the keyboard is in sleep mode,
+// at most once in SWITCH_TUNING_SAVE_INTERVAL. Only changed bytes are written.
+void save_switch_tuning() {
+
+  if (!switch_tuning_changed || millis() - last_action_time < DELAY_SLEEP_MODE ||
+      millis() - switch_tuning_saved_time < SWITCH_TUNING_SAVE_INTERVAL) {
+    return;
+  }
+
+  for (uint16_t n = 0; n < ROWS * COLUMNS; n += 2) {
+    uint8_t levels = debounce_level(states[n / COLUMNS][n % COLUMNS].debounce_time);
+    if (n + 1 < ROWS * COLUMNS) {
+      levels |= debounce_level(states[(n + 1) / COLUMNS][(n + 1) % COLUMNS].debounce_time) << 4;
+    }
+    EEPROM.update(EEPROM_SWITCH_TUNING + 1 + n / 2, levels);
+  }
+
+#if E2END + 1 >= EEPROM_SWITCH_STATS_END
+  for (uint16_t n = 0; n < ROWS * COLUMNS; n++) {
+    struct SwitchStats *stats = &switch_stats[n / COLUMNS][n % COLUMNS];
+    int address = EEPROM_SWITCH_STATS + n * 4;
+
+    EEPROM.update(address, stats->bounces & 0xFF);
+    EEPROM.update(address + 1, stats->bounces >> 8);
+    EEPROM.update(address + 2, stats->chatters > 0xFF ? 0xFF : stats->chatters); // Saved in one byte
+    EEPROM.update(address + 3, stats->bounce_max);
+  }
+#endif
+
+  EEPROM.update(EEPROM_SWITCH_TUNING, EEPROM_SWITCH_TUNING_MAGIC);
+
+  switch_tuning_changed = false;
+  switch_tuning_saved_time = millis();
+}
+
+// Sends the debounce times and statistics of all switches after the 's' command
+// (see process_serial_commands()), one switch per loop. Times are in 0.1 ms:
+//   # DAK switch stats,<rows>,<columns>
+//   <row>,<column>,<debounce time>,<bounces>,<longest bounce>,<chatters>
+//   # end
+void export_switch_stats() {
+
+  if (switch_stats_export_index < 0 || !serial_line_can_be_sent()) {
+    return;
+  }
+
+  if (switch_stats_export_index == 0) {
+    Serial.print("# DAK switch stats,");
+    Serial.print(ROWS);
+    Serial.print(',');
+    Serial.println(COLUMNS);
+  }
+
+  uint8_t r = switch_stats_export_index / COLUMNS;
+  uint8_t c = switch_stats_export_index % COLUMNS;
+
+  Serial.print(r);
+  Serial.print(',');
+  Serial.print(c);
+  Serial.print(',');
+  Serial.print(states[r][c].debounce_time);
+  Serial.print(',');
+  Serial.print(switch_stats[r][c].bounces);
+  Serial.print(',');
+  Serial.print(switch_stats[r][c].bounce_max);
+  Serial.print(',');
+  Serial.println(switch_stats[r][c].chatters);
+
+  if (++switch_stats_export_index >= ROWS * COLUMNS) {
+    Serial.println("# end");
+    switch_stats_export_index = -1;
+  }
+}
@@ -0,0 +1,76 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    debug_log.ino - binary debug log that does not block the main loop.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Debug events are stored as fixed size records (struct LogRecord) to a ring buffer,
+which only costs a few writes in the main loop. The records are sent to the serial
+port when the keyboard is idle and only as much as fits into the serial buffer,
+thus, printing never delays key strokes. If the buffer is full, new records are
+dropped and counted, the count is sent as a LOG_DROPPED record.
+
+On the serial port each record is preceded by DEBUG_LOG_SYNC. The records can be
+decoded using tools/decode_debug_log.py. The text exports (see process_serial_commands())
+start only when the buffer is empty and the log waits until they are finished.
+*/
+
+#ifdef DEBUG_LOG
+
+#define DEBUG_LOG_SYNC 0xA5
+
+void debug_log_write(uint8_t event, uint8_t arg, uint16_t a0, uint16_t a1, uint16_t a2) {
+
+  uint8_t next = (debug_log_head + 1) & (DEBUG_LOG_SIZE - 1);
+
+  if (next == debug_log_tail) {
+    debug_log_dropped++; // Buffer full
+    return;
+  }
+
+  struct LogRecord *record = &debug_log[debug_log_head];
+  record->time = micros();
+  record->event = (LogEvent)event;
+  record->arg = arg;
+  record->args[0] = a0;
+  record->args[1] = a1;
+  record->args[2] = a2;
+
+  debug_log_head = next;
+}
+
+void send_debug_log() {
+
+  if (millis() - last_action_time < DEBUG_LOG_IDLE_TIME || !Serial || serial_export_active()) {
+    return; // Keyboard is in use, the serial port is not open or a text export is being sent.
+  }
+
+  if (debug_log_dropped != 0 && debug_log_head == debug_log_tail) {
+    // Report dropped records once the buffer has been emptied.
+    debug_log_write(LOG_DROPPED, 0, debug_log_dropped & 0xFFFF, debug_log_dropped >> 16, 0);
+    debug_log_dropped = 0;
+  }
+
+  while (debug_log_tail != debug_log_head && Serial.availableForWrite() > (int)sizeof(struct LogRecord)) {
+    Serial.write(DEBUG_LOG_SYNC);
+    Serial.write((const uint8_t *)&debug_log[debug_log_tail], sizeof(struct LogRecord));
+    debug_log_tail = (debug_log_tail + 1) & (DEBUG_LOG_SIZE - 1);
+  }
+}
+
+#endif
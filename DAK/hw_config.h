@@ -27,13 +27,30 @@
 //#define DAK20
 //#define DAK30
 
-// If the DEBUG_PRINT_STATES_ARRAY is uncommented, will the states array be printed to the serial monitor. 
+// If the DEBUG_PRINT_STATES_ARRAY is uncommented, will each change of a switch be sent to the serial port. 
 // This feature is useful to make sure that all switches are working properly. Use only for debugging.
 // To enable the serialport set in the IDE: Tools -> USB type: -> 'Serial + Keyboard + Mouse + Joystic'
+// The debug output is a binary log (see debug_log.ino), use tools/decode_debug_log.py to read it.
+// The keyboard works normally while the debug output is enabled.
+// The debounce times and bounce statistics of the switches (debounce.ino) are sent as text after
+// sending 's' to the serial port (e.g., from the Serial Monitor), also without the debug output.
 
-//#define DEBUG_PRINT_STATES_ARRAY // define to print the state of each switch (no key strokes will be sent)
+//#define DEBUG_PRINT_STATES_ARRAY // define to log the state changes of each switch
 //#define DEBUG_PRINT // define to enable verbose ouput of keyboard status.
 
+// If MOUSE_KEYS is uncommented, the joystick is used as a mouse (see layout_config_FI.h). The mouse
+// actions (MOUSE_*) can also be used on any other key, on a DOUBLE_ACTION key the 1. action starts
+// after DELAY_TIME.
+// Requires a USB type with mouse, set in the IDE: Tools -> USB type: -> 'Keyboard + Mouse + Joystick'
+
+//#define MOUSE_KEYS
+
+// If USAGE_COUNTERS is uncommented, the presses of each action are counted and saved to the EEPROM.
+// The counts can be read from the serial port, see tools/merge_usage.py
+// Uses about 1 kB RAM, on Teensy-LC the counts are not saved (the EEPROM is too small).
+
+//#define USAGE_COUNTERS
+
 // KEY MATRIX size:
 #define ROWS 11
 #define COLUMNS 14
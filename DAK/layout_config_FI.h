@@ -175,16 +175,39 @@ Note, key code/modifier "0" indicates: no action.
                                                             
 //*******************************************//
 // Joystick
+#ifndef MOUSE_KEYS
 #define K67  ADDITIVE_ACTION,ADDITIVE_ACTION,{KEY_DOWN,0,KEY_DOWN,0},{0,0,GUI,0},B_down,{0,0} // Note, {0,0} refers to the same button as B1A, this is not a problem as long as neither second action is enabled (i.e., equals 0).
 #define K68  ADDITIVE_ACTION,ADDITIVE_ACTION,{KEY_RIGHT,0,KEY_RIGHT,0},{0,0,GUI,0},B_right,{0,0}
 #define K69  ADDITIVE_ACTION,ADDITIVE_ACTION,{KEY_DELETE,0,0,0},{0,0,0,0},B_center,{0,0}
 #define K70  ADDITIVE_ACTION,ADDITIVE_ACTION,{KEY_UP,0,KEY_UP,0},{0,0,GUI,0},B_up,{0,0}
 #define K71  ADDITIVE_ACTION,ADDITIVE_ACTION,{KEY_LEFT,0,KEY_LEFT,0},{0,0,GUI,0},B_left,{0,0}
+#else
+// Mouse: normal-layer moves the cursor, FN-layer scrolls. Center: left click (normal-layer), right click (FN-layer).
+#define K67  ADDITIVE_ACTION,ADDITIVE_ACTION,{MOUSE_MOVE_DOWN,0,MOUSE_SCROLL_DOWN,0},{0,0,0,0},B_down,{0,0}
+#define K68  ADDITIVE_ACTION,ADDITIVE_ACTION,{MOUSE_MOVE_RIGHT,0,MOUSE_SCROLL_RIGHT,0},{0,0,0,0},B_right,{0,0}
+#define K69  ADDITIVE_ACTION,ADDITIVE_ACTION,{MOUSE_CLICK_LEFT,0,MOUSE_CLICK_RIGHT,0},{0,0,0,0},B_center,{0,0}
+#define K70  ADDITIVE_ACTION,ADDITIVE_ACTION,{MOUSE_MOVE_UP,0,MOUSE_SCROLL_UP,0},{0,0,0,0},B_up,{0,0}
+#define K71  ADDITIVE_ACTION,ADDITIVE_ACTION,{MOUSE_MOVE_LEFT,0,MOUSE_SCROLL_LEFT,0},{0,0,0,0},B_left,{0,0}
+#endif
+
+/*
+Acceleration curves of the mouse actions. Each value is the speed after holding
+the action for a multiple of MOUSE_CURVE_STEP ms (0 ms, 200 ms, 400 ms, ...), the
+speed between the values is interpolated and the last value is kept. The first
+report of a press always moves one pixel (or scroll step), which allows precise
+positioning with short presses.
+
+Examples (pixels/s):
+Linear:      {100, 400, 700, 1000, 1300, 1600}
+Quadratic:   {100, 160, 340, 640, 1060, 1600}
+Constant:    {600}
+*/
+const uint16_t mouse_move_curve[] = {100, 160, 340, 640, 1060, 1600}; // pixels/s
+const uint16_t mouse_scroll_curve[] = {8, 12, 20, 30};                // scroll steps/s
 
 // Define an constant array for storing all constant information of each key.
 const struct KeyConst keys_const[] =
 {
-#ifndef DEBUG_PRINT_STATES_ARRAY // No keys are defined when debug mode is active.
 {K1},
 {K2},
 {K3},
@@ -256,7 +279,6 @@ const struct KeyConst keys_const[] =
 {K69},
 {K70},
 {K71}
-#endif
 };
 
 const int NUMBER_OF_KEYS = sizeof(keys_const)/sizeof(struct KeyConst);
@@ -265,10 +287,42 @@ const int NUMBER_OF_KEYS = sizeof(keys_const)/sizeof(struct KeyConst);
 #define DEFAULT_VALUES false,{0},{NORMAL},DISABLED
 struct Key keys[NUMBER_OF_KEYS] =
 {
-#ifndef DEBUG_PRINT_STATES_ARRAY // No keys are defined when debug mode is active.
 {DEFAULT_VALUES}
-#endif
 };
 
+/*
+Combos are actions that are triggered when several switches are pressed together.
+A combo can use any switch of the states array, thus, it can be bound to the 1. or
+the 2. action of any key. The following syntax is used:
+#define
+[COMBO NAME]
+[layer (L1 = normal-layer, L2 = FN-layer)],
+[term (ms), time window in which all switches need to be pressed],
+[key code],
+[modifiers],
+[number of switches (max COMBO_MAX_SWITCHES)],
+{[switch], [switch], ...}
+
+The switches of a combo are held back until the combo has been resolved, i.e.,
+the switches are sent as normal key strokes if the combo is not completed within
+the term. Switches that are not part of any combo on the active layer are not
+delayed. If combos overlap (e.g., J+K and J+K+L), the combo with more switches
+is preferred when it is completed within the term.
+*/
+
+// Example: 1. actions of J and K -> ESC
+//#define C1   L1,50,KEY_ESC,0,2,{B38A,B39A}
+
+// Define an constant array for storing all combos.
+const struct ComboConst combos_const[] =
+{
+//{C1},
+};
+
+const int NUMBER_OF_COMBOS = sizeof(combos_const)/sizeof(struct ComboConst);
+
+// Define an array for storing all non-constant information of each combo.
+struct Combo combos[NUMBER_OF_COMBOS];
+
 
 #endif
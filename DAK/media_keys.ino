@@ -0,0 +1,132 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    media_keys.ino - keeps track of media and system keys and sends them to the host.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Media and system keys (consumer and system control reports) work only when they are
+activated using the Keyboard.press() function, which sends a report on each call.
+Therefore, the keys only update the media_keys array and send_media_keys() sends
+the changes once per loop. A key that is pressed and released during the same loop
+is still sent as a short press.
+
+Repeating media keys (MEDIA_KEY_REPEATS, e.g., volume) are sent as short presses:
+once when pressed and then every MEDIA_REPEAT_INTERVAL after MEDIA_REPEAT_DELAY,
+so that the repeat rate is controlled by the firmware instead of the host.
+*/
+
+void press_media_key(uint16_t key_code) {
+
+  struct MediaKey *free_slot = NULL;
+
+  for (uint8_t m = 0; m < MEDIA_KEY_SLOTS; m++) {
+    if (media_keys[m].key_code == key_code) {
+      free_slot = &media_keys[m]; // Already in use -> press again
+      break;
+    }
+    if (media_keys[m].key_code == 0 && free_slot == NULL) {
+      free_slot = &media_keys[m];
+    }
+  }
+
+  if (free_slot == NULL) {
+    return; // If already MEDIA_KEY_SLOTS keys are pressed nothing will happen.
+  }
+
+  if (free_slot->key_code == 0) {
+    free_slot->key_code = key_code;
+    active_media_keys++;
+  }
+  free_slot->held = true;
+  if (!free_slot->sent || MEDIA_KEY_REPEATS(key_code)) {
+    free_slot->pressed = true;
+  }
+  free_slot->repeat_time = millis() + MEDIA_REPEAT_DELAY;
+}
+
+void release_media_key(uint16_t key_code) {
+  for (uint8_t m = 0; m < MEDIA_KEY_SLOTS; m++) {
+    if (media_keys[m].key_code == key_code) {
+      media_keys[m].held = false;
+    }
+  }
+}
+
+// Used when the layer is changed.
+void release_all_media_keys() {
+
+  for (uint8_t m = 0; m < MEDIA_KEY_SLOTS; m++) {
+    if (media_keys[m].sent) {
+      Keyboard.release(media_keys[m].key_code);
+#ifdef DEBUG_PRINT
+      LOG_EVENT(LOG_MEDIA_KEY_RELEASED, 0, media_keys[m].key_code, 0, 0);
+#endif
+    }
+    media_keys[m].key_code = 0;
+    media_keys[m].held = false;
+    media_keys[m].pressed = false;
+    media_keys[m].sent = false;
+  }
+  active_media_keys = 0;
+}
+
+void send_media_keys() {
+
+  if (active_media_keys == 0) {
+    return;
+  }
+
+  for (uint8_t m = 0; m < MEDIA_KEY_SLOTS; m++) {
+    struct MediaKey *key = &media_keys[m];
+
+    if (key->key_code == 0) {
+      continue;
+    }
+
+    bool repeats = MEDIA_KEY_REPEATS(key->key_code);
+
+    if (key->sent) {
+      // Repeating keys are released after one loop, other keys once they are released.
+      if (!key->held || repeats) {
+        Keyboard.release(key->key_code);
+        key->sent = false;
+#ifdef DEBUG_PRINT
+        LOG_EVENT(LOG_MEDIA_KEY_RELEASED, 0, key->key_code, 0, 0);
+#endif
+      }
+
+    } else if (key->pressed || (key->held && repeats && (int32_t)(millis() - key->repeat_time) >= 0)) {
+
+      if (!key->pressed) {
+        key->repeat_time += MEDIA_REPEAT_INTERVAL;
+      }
+
+      Keyboard.press(key->key_code);
+      key->pressed = false;
+      key->sent = true;
+#ifdef DEBUG_PRINT
+      LOG_EVENT(LOG_MEDIA_KEY_PRESSED, 0, key->key_code, 0, 0);
+#endif
+    }
+
+    if (!key->held && !key->pressed && !key->sent) {
+      key->key_code = 0;
+      active_media_keys--;
+    }
+  }
+}
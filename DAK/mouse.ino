@@ -0,0 +1,168 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    mouse.ino - mouse actions, used e.g. to control the cursor with the joystick.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Movement and scrolling are sent in mouse reports every MOUSE_REPORT_INTERVAL us. The
+movement is computed from the acceleration curves (layout_config_FI.h) for each elapsed
+interval, thus, the speed of the cursor doesn't depend on the loop time. All calculations
+are done in fixed point (1/256 pixels), the part that doesn't fit into a report is kept in
+mouse_remainder for the next report.
+
+Clicks are sent right away.
+*/
+
+#ifdef MOUSE_KEYS
+
+// Axis (index of mouse_remainder) and direction of each movement and scroll action.
+const int8_t MOUSE_AXIS[] = {1, 1, 0, 0, 2, 2, 3, 3};
+const int8_t MOUSE_DIRECTION[] = {-1, 1, -1, 1, 1, -1, -1, 1};
+
+// Mouse buttons of the click actions.
+const uint8_t MOUSE_BUTTON[] = {MOUSE_LEFT, MOUSE_RIGHT, MOUSE_MIDDLE};
+
+#define MOUSE_CURVE_LENGTH(curve) (sizeof(curve) / sizeof(curve[0]))
+
+void press_mouse_key(uint16_t key_code) {
+  uint8_t action = key_code & 0x0F;
+  uint16_t bit = MOUSE_BIT(key_code);
+
+  if (key_code >= MOUSE_CLICK_LEFT) {
+    if (key_code <= MOUSE_CLICK_MIDDLE && !(mouse_keys & bit)) {
+      Mouse.press(MOUSE_BUTTON[key_code - MOUSE_CLICK_LEFT]);
+      mouse_keys |= bit;
+    }
+    return;
+  }
+
+  if ((mouse_keys & (MOUSE_MOVE_BITS | MOUSE_SCROLL_BITS)) == 0) {
+    mouse_report_time = micros(); // First report right away
+  }
+  if ((bit & MOUSE_MOVE_BITS) && (mouse_keys & MOUSE_MOVE_BITS) == 0) {
+    mouse_move_time = millis();
+  }
+  if ((bit & MOUSE_SCROLL_BITS) && (mouse_keys & MOUSE_SCROLL_BITS) == 0) {
+    mouse_scroll_time = millis();
+  }
+
+  // The first report moves one pixel (or scroll step).
+  mouse_remainder[MOUSE_AXIS[action]] = MOUSE_DIRECTION[action] * 256;
+
+  mouse_keys |= bit;
+}
+
+void release_mouse_key(uint16_t key_code) {
+  uint8_t action = key_code & 0x0F;
+  uint16_t bit = MOUSE_BIT(key_code);
+
+  if (!(mouse_keys & bit)) {
+    return;
+  }
+  mouse_keys &= ~bit;
+
+  if (key_code >= MOUSE_CLICK_LEFT) {
+    Mouse.release(MOUSE_BUTTON[key_code - MOUSE_CLICK_LEFT]);
+    return;
+  }
+
+  // Clear the movement of the axis if neither direction is pressed.
+  if ((mouse_keys & (MOUSE_BIT(action) | MOUSE_BIT(action ^ 1))) == 0) {
+    mouse_remainder[MOUSE_AXIS[action]] = 0;
+  }
+}
+
+// Used when the layer is changed.
+void release_all_mouse_keys() {
+  for (uint16_t key_code = MOUSE_MOVE_UP; key_code <= MOUSE_CLICK_MIDDLE; key_code++) {
+    release_mouse_key(key_code);
+  }
+}
+
+// Returns the speed of the curve (per second) after the action has been held for the given time (ms).
+uint32_t mouse_curve_speed(const uint16_t *curve, uint8_t length, uint32_t time) {
+  uint32_t index = time / MOUSE_CURVE_STEP;
+
+  if (index + 1 >= length) {
+    return curve[length - 1];
+  }
+
+  int32_t fraction = time % MOUSE_CURVE_STEP;
+  return curve[index] + ((int32_t)curve[index + 1] - (int32_t)curve[index]) * fraction / MOUSE_CURVE_STEP;
+}
+
+void send_mouse() {
+
+  if ((mouse_keys & (MOUSE_MOVE_BITS | MOUSE_SCROLL_BITS)) == 0) {
+    return;
+  }
+
+  unsigned long time_current = micros();
+  if ((long)(time_current - mouse_report_time) < 0) {
+    return; // Not yet time for the next report
+  }
+
+  // Number of report intervals that have passed, limited to avoid jumps after a long loop.
+  uint32_t intervals = (time_current - mouse_report_time) / MOUSE_REPORT_INTERVAL + 1;
+  if (intervals > 20) {
+    intervals = 20;
+    mouse_report_time = time_current + MOUSE_REPORT_INTERVAL; // Continue at the normal rate from now on
+  } else {
+    mouse_report_time += intervals * MOUSE_REPORT_INTERVAL;
+  }
+
+  // Movement during the intervals in 1/256 pixels (or scroll steps).
+  int32_t step[2];
+  step[0] = mouse_curve_speed(mouse_move_curve, MOUSE_CURVE_LENGTH(mouse_move_curve), millis() - mouse_move_time) *
+    intervals * (MOUSE_REPORT_INTERVAL * 256UL / 1000) / 1000;
+  step[1] = mouse_curve_speed(mouse_scroll_curve, MOUSE_CURVE_LENGTH(mouse_scroll_curve), millis() - mouse_scroll_time) *
+    intervals * (MOUSE_REPORT_INTERVAL * 256UL / 1000) / 1000;
+
+  for (uint8_t action = 0; action < 8; action++) {
+    if (mouse_keys & (1 << action)) {
+      mouse_remainder[MOUSE_AXIS[action]] += MOUSE_DIRECTION[action] * step[action >> 2];
+    }
+  }
+
+  // Send the whole pixels, keep the rest.
+  int8_t report[4];
+  bool move = false;
+
+  for (uint8_t axis = 0; axis < 4; axis++) {
+    int32_t value = mouse_remainder[axis] / 256;
+
+    if (value > 127) {
+      value = 127;
+    } else if (value < -127) {
+      value = -127;
+    }
+
+    mouse_remainder[axis] -= value * 256;
+    report[axis] = value;
+    move |= value != 0;
+  }
+
+  if (move) {
+    Mouse.move(report[0], report[1], report[2], report[3]);
+  }
+
+  // Keep the keyboard out of sleep mode while the mouse is used.
+  last_action_time = millis();
+}
+
+#endif
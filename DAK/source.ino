@@ -41,24 +41,42 @@ void read_switches() {
       uint8_t pin_state = digitalRead(ROW_PINS[r]);
       //Serial.println(analogRead(ROW_PINS[r]));
 
-      if (states[r][c].switch_bounce_time != 0 && time_current - states[r][c].switch_bounce_time >= DELAY_TIME_BOUNCE) { 
+      // A switch held back by the combo engine is pressed, although it is not yet in the states array.
+      uint8_t state = states[r][c].state | (uint8_t)SWITCH_MASK_GET(combo_pending_switches, r, c);
+
+      if (states[r][c].switch_bounce_time != 0 && time_current - states[r][c].switch_bounce_time >= states[r][c].debounce_time) { 
         // If the switch is in a constant state -> add the change to the states array.
+
+        if (hold_switch_for_combo(r, c, pin_state)) {
+          // The change is added to the states array once the combo engine has resolved it.
+          continue;
+        }
         
         millis_tmp = millis();
         last_action_time = millis_tmp;
 
+        if (pin_state == 1 && states[r][c].state == 0) {
+          add_switch_press(r, c, millis_tmp - states[r][c].switch_state_changed_time);
+        }
+
         states[r][c].state = pin_state;
         states[r][c].switch_bounce_time = 0;
         states[r][c].switch_state_changed_time = millis_tmp;
+        state = pin_state;
+
+#ifdef DEBUG_PRINT_STATES_ARRAY
+        LOG_EVENT(LOG_SWITCH_CHANGED, pin_state, r, c, 0);
+#endif
       }
       
       //Set time:
-      if (pin_state != states[r][c].state && states[r][c].switch_bounce_time == 0) {
+      if (pin_state != state && states[r][c].switch_bounce_time == 0) {
         // State of the switch has changed for the first time.
         states[r][c].switch_bounce_time = time_current;
 
-      } else if (pin_state == states[r][c].state && states[r][c].switch_bounce_time != 0) {
+      } else if (pin_state == state && states[r][c].switch_bounce_time != 0) {
         // The state of the switch is not definite -> reset bounce timer
+        add_switch_bounce(r, c, time_current - states[r][c].switch_bounce_time);
         states[r][c].switch_bounce_time = 0;
       }
     }
@@ -71,17 +89,6 @@ void read_switches() {
 
   }
 
-#ifdef DEBUG_PRINT_STATES_ARRAY
-  for (int r = 0; r < ROWS; r++) {
-    for (int c = 0; c < COLUMNS; c++) {
-      Serial.print(states[r][c].state);
-      Serial.print("\t");
-    }
-    Serial.println("");
-  }
-  Serial.println("************************************************************");
-  delay(100);
-#endif
 }
 
 // Updated key state by putting the key to ENABLED if the 
@@ -306,54 +313,83 @@ void process_double_action_key_no_delay(uint8_t i) {
 
 void set_keys(uint8_t i, uint8_t layer) {
 
+#ifdef USAGE_COUNTERS
+  key_usage[i][layer]++;
+#endif
+
+  // Marks the action pressed, so that it is not pressed again while held (e.g., DOUBLE_ACTION after DELAY_TIME).
+  keys[i].active_key_position[layer] = ACTION_ACTIVE;
+
   if (KEY_MEDIA_OR_KEY_SYSTEM(layer)) {
     
-    // Multimedia keys work only when they are activated using the Keyboard.press() function.
-    Keyboard.press(keys_const[i].key_code[layer]);
-    
-#ifdef DEBUG_PRINT
-    Serial.print("Media key pressed: ");
-    Serial.println(keys_const[i].key_code[layer]);
+    // Multimedia keys are sent separately by send_media_keys().
+    press_media_key(keys_const[i].key_code[layer]);
+
+#ifdef MOUSE_KEYS
+  } else if (KEY_MOUSE(layer)) {
+
+    // Mouse actions are sent by send_mouse().
+    press_mouse_key(keys_const[i].key_code[layer]);
 #endif
     
   } else {
     // Other keys are enabled using the Keyboard.set_keyX() functions
-
-    // The for loop looks for a empty place in the active_key_register array.
-    for (uint8_t index = 1; index < 7; index++) { // If already 6 keys are pressed nothing will happen.
-      
-      if (active_key_regiser[index] == 0 && keys_const[i].key_code[layer] != 0) { // Functions with only modifiers in them, will skip this part.
-
-        keys[i].active_key_position[layer] = index; // Used for releasing the right keys later.
-        active_key_regiser[index] = keys_const[i].key_code[layer]; // Used keeping track of what Keyboard.set_keyX() are currently in use.
-
-        switch (index) {
-          case 1:
-            Keyboard.set_key1(keys_const[i].key_code[layer]);
-            break;
-          case 2:
-            Keyboard.set_key2(keys_const[i].key_code[layer]);
-            break;
-          case 3:
-            Keyboard.set_key3(keys_const[i].key_code[layer]);
-            break;
-          case 4:
-            Keyboard.set_key4(keys_const[i].key_code[layer]);
-            break;
-          case 5:
-            Keyboard.set_key5(keys_const[i].key_code[layer]);
-            break;
-          case 6:
-            Keyboard.set_key6(keys_const[i].key_code[layer]);
-            break;
-        }
-        break;
-      }
+    uint8_t index = register_key_code(keys_const[i].key_code[layer]);
+    
+    if (index != 0) {
+      keys[i].active_key_position[layer] = index; // Used for releasing the right keys later.
     }
     Keyboard.send_now();
   }
 }
 
+// Looks for an empty place in the active_key_register array and enables the key code using the
+// Keyboard.set_keyX() functions. Returns the place in the register, or 0 if nothing was done.
+uint8_t register_key_code(uint16_t key_code) {
+
+  if (key_code == 0) {
+    return 0; // Functions with only modifiers in them, will skip this part.
+  }
+
+  for (uint8_t index = 1; index < 7; index++) { // If already 6 keys are pressed nothing will happen.
+    if (active_key_regiser[index] == 0) {
+      active_key_regiser[index] = key_code; // Used keeping track of what Keyboard.set_keyX() are currently in use.
+      set_keyboard_key(index, key_code);
+      return index;
+    }
+  }
+  return 0;
+}
+
+// Frees a place in the active_key_register array.
+void unregister_key_code(uint8_t index) {
+  active_key_regiser[index] = 0;
+  set_keyboard_key(index, 0);
+}
+
+void set_keyboard_key(uint8_t index, uint16_t key_code) {
+  switch (index) {
+    case 1:
+      Keyboard.set_key1(key_code);
+      break;
+    case 2:
+      Keyboard.set_key2(key_code);
+      break;
+    case 3:
+      Keyboard.set_key3(key_code);
+      break;
+    case 4:
+      Keyboard.set_key4(key_code);
+      break;
+    case 5:
+      Keyboard.set_key5(key_code);
+      break;
+    case 6:
+      Keyboard.set_key6(key_code);
+      break;
+  }
+}
+
 bool pressed_modifier_keys_contains_key(uint8_t i) {
   for (int x = 0; x < 10; x++) {
     if (pressed_modifier_keys[x] == i || pressed_modifier_keys[x] == i + NUMBER_OF_KEYS) {
@@ -450,12 +486,13 @@ void release_keys() {
     if ((states[r][c].state == 0 && states[r][c].last_state != states[r][c].state) /*|| FN_KEYS_ARE_RELEASED -duplicate*/ ) {
 
       if (KEY_MEDIA_OR_KEY_SYSTEM(0 + keyboard_layer)) {
-        Keyboard.release(keys_const[i].key_code[0 + keyboard_layer]);
-#ifdef DEBUG_PRINT
-    Serial.print("Media key released: ");
-    Serial.println(keys_const[i].key_code[0 + keyboard_layer]);
-#endif
+        release_media_key(keys_const[i].key_code[0 + keyboard_layer]);
       }
+#ifdef MOUSE_KEYS
+      if (KEY_MOUSE(0 + keyboard_layer)) {
+        release_mouse_key(keys_const[i].key_code[0 + keyboard_layer]);
+      }
+#endif
 
       RELEASE_MODIFIER(keys_const[i].modifier_code[0 + keyboard_layer]); // Release 1. layer
 
@@ -479,12 +516,13 @@ void release_keys() {
 
     if (states[r][c].state == 0 && states[r][c].last_state != states[r][c].state) { //2. action released
       if (KEY_MEDIA_OR_KEY_SYSTEM(1 + keyboard_layer)) {
-        Keyboard.release(keys_const[i].key_code[1 + keyboard_layer]);
-#ifdef DEBUG_PRINT
-    Serial.print("Media key released: ");
-    Serial.println(keys_const[i].key_code[1 + keyboard_layer]);
-#endif
+        release_media_key(keys_const[i].key_code[1 + keyboard_layer]);
       }
+#ifdef MOUSE_KEYS
+      if (KEY_MOUSE(1 + keyboard_layer)) {
+        release_mouse_key(keys_const[i].key_code[1 + keyboard_layer]);
+      }
+#endif
       RELEASE_MODIFIER(keys_const[i].modifier_code[1 + keyboard_layer]); // Release 2. action modifier
       release_key(i, 1 + keyboard_layer);// Release 2. action
       Keyboard.send_now();
@@ -502,27 +540,8 @@ void release_key(uint8_t i, uint8_t layer) {
   uint8_t index = keys[i].active_key_position[layer];
   if (index != 0) {
     keys[i].active_key_position[layer] = 0;
-    active_key_regiser[index] = 0;
-
-    switch (index) {
-      case 1:
-        Keyboard.set_key1(0);
-        break;
-      case 2:
-        Keyboard.set_key2(0);
-        break;
-      case 3:
-        Keyboard.set_key3(0);
-        break;
-      case 4:
-        Keyboard.set_key4(0);
-        break;
-      case 5:
-        Keyboard.set_key5(0);
-        break;
-      case 6:
-        Keyboard.set_key6(0);
-        break;
+    if (index != ACTION_ACTIVE) {
+      unregister_key_code(index);
     }
   }
 }
@@ -553,6 +572,9 @@ void set_fn_lock() {
 void reset_keyboard(){
   // This function is used to reset the keyboard when the layer is changed.
 
+  // Release combos and add held switches to the states array, so that their keys are disabled below.
+  reset_combos();
+
   // Reset flag
   modifier_pressed_before_non_a_modifier_key = false;
 
@@ -586,24 +608,14 @@ void reset_keyboard(){
     release_key(i, 1 + keyboard_layer); // Release 2. action
  
     Keyboard.send_now();
-  
-    // Special handling of media/system keys
-    if (KEY_MEDIA_OR_KEY_SYSTEM(0 + keyboard_layer)) {
- //     Keyboard.release(keys_const[i].key_code[0 + keyboard_layer]);
-#ifdef DEBUG_PRINT
-//    Serial.print("Media key released: ");
- //   Serial.println(keys_const[i].key_code[0 + keyboard_layer]);
-#endif
-    }
-    if (KEY_MEDIA_OR_KEY_SYSTEM(1 + keyboard_layer)) {
-  //    Keyboard.release(keys_const[i].key_code[1 + keyboard_layer]);
-#ifdef DEBUG_PRINT
-  //  Serial.print("Media key released: ");
-  //  Serial.println(keys_const[i].key_code[1 + keyboard_layer]);
+  }
+
+  // Media/system keys are released separately, as they might have been pressed on the other layer.
+  release_all_media_keys();
+#ifdef MOUSE_KEYS
+  release_all_mouse_keys();
 #endif
-    }
 
-  }
   Keyboard.releaseAll();
   //last_action_time = millis();
 }
@@ -615,8 +627,7 @@ void set_current_layer(){
     reset_keyboard();
     keyboard_layer = L2;
 #ifdef DEBUG_PRINT
-    Serial.print("Layer ");
-    Serial.println(keyboard_layer);
+    LOG_EVENT(LOG_LAYER_CHANGED, keyboard_layer, 0, 0, 0);
 #endif
 
   } else if (keyboard_layer == L2 && FN_LAYER_NOT_ACTIVE){
@@ -624,8 +635,7 @@ void set_current_layer(){
     reset_keyboard();
     keyboard_layer = L1;
 #ifdef DEBUG_PRINT
-    Serial.print("Layer ");
-    Serial.println(keyboard_layer);
+    LOG_EVENT(LOG_LAYER_CHANGED, keyboard_layer, 0, 0, 0);
 #endif
 
   } else {
@@ -647,4 +657,46 @@ void set_sleep_mode() {
   if (millis() - last_action_time >= DELAY_SLEEP_MODE) {
     delay(SLEEP_DELAY_TIME);
   }
-}
\ No newline at end of file
+}
+
+// Commands received from the serial port, the answers are sent as text:
+// 's' - send the debounce times and bounce statistics of the switches (debounce.ino)
+// 'u' - send the usage counters (usage.ino)
+// A command is read only when nothing else is being sent, so that the text is not mixed
+// with another export or with the binary debug log (which waits while an export is active).
+void process_serial_commands() {
+
+  if (!Serial.available() || serial_export_active()) {
+    return;
+  }
+#ifdef DEBUG_LOG
+  if (debug_log_head != debug_log_tail) {
+    return;
+  }
+#endif
+
+  switch (Serial.read()) {
+    case 's':
+      switch_stats_export_index = 0;
+      break;
+#ifdef USAGE_COUNTERS
+    case 'u':
+      key_usage_export_index = 0;
+      break;
+#endif
+  }
+}
+
+bool serial_export_active() {
+#ifdef USAGE_COUNTERS
+  if (key_usage_export_index >= 0) {
+    return true;
+  }
+#endif
+  return switch_stats_export_index >= 0;
+}
+
+// The exports send one line per loop if there is room in the send buffer, so that typing is not delayed.
+bool serial_line_can_be_sent() {
+  return Serial.availableForWrite() >= SERIAL_LINE_MAX;
+}
@@ -0,0 +1,184 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    usage.ino - counts the presses of each action and saves the counts to the EEPROM.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+set_keys() increments key_usage[i][layer] on every press of an action, nothing else
+is done while typing. The counts are saved to the EEPROM in sleep mode, at most once
+in USAGE_SAVE_INTERVAL.
+
+Only the defined actions of the layout are saved (4 bytes each). The EEPROM after the
+switch statistics is divided into as many banks as fit (max USAGE_BANKS_MAX) and the
+saves go to the banks in turns, so that each bank is written only every n:th time.
+A bank starts with a sequence number and the layout id, the bank with the latest
+sequence number is loaded at startup. A save first marks the bank erased (sequence
+0xFFFF) and writes the header last, thus, a bank that was being written when the
+power was lost is skipped. With several banks the previous save is then loaded,
+with one bank the counts start from zero.
+
+The counts are sent to the serial port as text after the 'u' command (see
+process_serial_commands()), tools/merge_usage.py combines them into a heatmap.
+*/
+
+#ifdef USAGE_COUNTERS
+
+#define USAGE_ACTION_DEFINED(i, a) (keys_const[i].key_code[a] != 0 || keys_const[i].modifier_code[a] != 0)
+#define USAGE_BANK_HEADER 4 // Sequence number and layout id, 2 bytes each
+
+uint16_t eeprom_read_uint16(int address) {
+  return EEPROM.read(address) | (EEPROM.read(address + 1) << 8);
+}
+
+void eeprom_update_uint16(int address, uint16_t value) {
+  EEPROM.update(address, value & 0xFF);
+  EEPROM.update(address + 1, value >> 8);
+}
+
+void load_usage_counters() {
+
+  // Layout id and number of saved actions.
+  uint16_t actions = 0;
+  key_usage_layout_id = NUMBER_OF_KEYS;
+
+  for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+    for (uint8_t a = 0; a < 4; a++) {
+      key_usage_layout_id = key_usage_layout_id * 31 + keys_const[i].key_code[a];
+      key_usage_layout_id = key_usage_layout_id * 31 + keys_const[i].modifier_code[a];
+      if (USAGE_ACTION_DEFINED(i, a)) {
+        actions++;
+      }
+    }
+  }
+
+  key_usage_bank_size = USAGE_BANK_HEADER + actions * 4;
+  key_usage_saved_time = millis();
+
+  int space = (int)EEPROM.length() - EEPROM_USAGE_COUNTERS;
+  key_usage_banks = space > 0 ? space / key_usage_bank_size : 0;
+  if (key_usage_banks > USAGE_BANKS_MAX) {
+    key_usage_banks = USAGE_BANKS_MAX;
+  }
+
+  // Find the latest save of this layout.
+  bool found = false;
+
+  for (uint8_t b = 0; b < key_usage_banks; b++) {
+    int address = EEPROM_USAGE_COUNTERS + b * key_usage_bank_size;
+    uint16_t sequence = eeprom_read_uint16(address);
+
+    if (sequence == 0xFFFF || eeprom_read_uint16(address + 2) != key_usage_layout_id) {
+      continue; // Erased or saved with another layout
+    }
+    if (!found || (int16_t)(sequence - key_usage_sequence) > 0) {
+      key_usage_bank = b;
+      key_usage_sequence = sequence;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    key_usage_bank = key_usage_banks - 1; // The first save goes to bank 0
+    return;
+  }
+
+  int address = EEPROM_USAGE_COUNTERS + key_usage_bank * key_usage_bank_size + USAGE_BANK_HEADER;
+
+  for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+    for (uint8_t a = 0; a < 4; a++) {
+      if (USAGE_ACTION_DEFINED(i, a)) {
+        key_usage[i][a] = (uint32_t)eeprom_read_uint16(address) | ((uint32_t)eeprom_read_uint16(address + 2) << 16);
+        address += 4;
+      }
+    }
+  }
+}
+
+// Saves the counters to the next bank when the keyboard is in sleep mode,
+// at most once in USAGE_SAVE_INTERVAL and only if keys have been pressed since the last save.
+void save_usage_counters() {
+
+  if (key_usage_banks == 0 || (long)(last_action_time - key_usage_saved_time) < 0 ||
+      millis() - last_action_time < DELAY_SLEEP_MODE || millis() - key_usage_saved_time < USAGE_SAVE_INTERVAL) {
+    return;
+  }
+
+  uint8_t bank = (key_usage_bank + 1) % key_usage_banks;
+  int header = EEPROM_USAGE_COUNTERS + bank * key_usage_bank_size;
+  int address = header + USAGE_BANK_HEADER;
+
+  eeprom_update_uint16(header, 0xFFFF); // Invalid until the counters are written
+
+  for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+    for (uint8_t a = 0; a < 4; a++) {
+      if (USAGE_ACTION_DEFINED(i, a)) {
+        eeprom_update_uint16(address, key_usage[i][a] & 0xFFFF);
+        eeprom_update_uint16(address + 2, key_usage[i][a] >> 16);
+        address += 4;
+      }
+    }
+  }
+
+  key_usage_sequence++;
+  if (key_usage_sequence == 0xFFFF) {
+    key_usage_sequence = 0; // 0xFFFF is an erased bank
+  }
+
+  eeprom_update_uint16(header + 2, key_usage_layout_id);
+  eeprom_update_uint16(header, key_usage_sequence);
+
+  key_usage_bank = bank;
+  key_usage_saved_time = millis();
+}
+
+// Sends the counters after the 'u' command, one key per loop so that typing is not delayed:
+//   # DAK usage,<layout id>,<number of keys>
+//   K<n>,<1. action>,<2. action>,<FN 1. action>,<FN 2. action>   (empty if the action is not defined)
+//   # end
+void export_usage_counters() {
+
+  if (key_usage_export_index < 0 || !serial_line_can_be_sent()) {
+    return;
+  }
+
+  if (key_usage_export_index == 0) {
+    Serial.print("# DAK usage,");
+    Serial.print(key_usage_layout_id, HEX);
+    Serial.print(',');
+    Serial.println(NUMBER_OF_KEYS);
+  }
+
+  uint8_t i = key_usage_export_index;
+
+  Serial.print('K');
+  Serial.print(i + 1);
+  for (uint8_t a = 0; a < 4; a++) {
+    Serial.print(',');
+    if (USAGE_ACTION_DEFINED(i, a)) {
+      Serial.print(key_usage[i][a]);
+    }
+  }
+  Serial.println();
+
+  if (++key_usage_export_index >= NUMBER_OF_KEYS) {
+    Serial.println("# end");
+    key_usage_export_index = -1;
+  }
+}
+
+#endif
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+DAK - is a firmware for Double Action Keyboards
+run_tests.py - builds the sketch for the host and runs the tests in this directory.
+
+The .ino tabs are combined like the Arduino IDE does it (DAK.ino first, then the
+others alphabetically, function prototypes after the includes) and compiled with
+the stubs of test/stub. Each test_*.cpp is included at the end of the sketch,
+thus, the tests can use all functions and globals of the firmware.
+
+A test can set the configuration with comment lines:
+    // SKETCH_FLAGS: -DMOUSE_KEYS           compiler flags, e.g., options of hw_config.h
+    // SKETCH_COMBOS: {L1,50,KEY_ESC,0,2,{B38A,B39A}},
+                                            combos added to combos_const[] of the layout
+    // SKETCH_LAYOUT: K33 DOUBLE_ACTION,DOUBLE_ACTION,{KEY_F,KEY_9,KEY_MEDIA_MUTE,0},{0,SHIFT,0,0},B33A,B33B
+                                            replaces the definition of a key in the layout
+
+Usage:
+    python3 test/run_tests.py [test_combos ...]
+
+Requires g++. Returns non-zero if a test fails.
+
+Copyright (C) 2022  Jaakob Lidauer
+Licensed under the GNU General Public License v3 or later, see LICENSE.
+"""
+
+import glob
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+SKETCH_DIR = os.path.join(TEST_DIR, "..", "DAK")
+
+CXX = os.environ.get("CXX", "g++")
+CXXFLAGS = ["-std=gnu++14", "-g", "-Wall", "-Wno-missing-field-initializers"]
+
+
+def prototypes(source):
+    # Function definitions at the start of a line, like the prototypes generated by the Arduino IDE.
+    code = re.sub(r"/\*.*?\*/", "", source, flags=re.S)
+    code = re.sub(r"//[^\n]*", "", code)
+    result = []
+    for match in re.finditer(r"^([A-Za-z_][\w \*&]*?\b)([a-z_]\w*)\s*\(([^;{}()]*)\)\s*\{", code, flags=re.M):
+        ret, name, args = match.groups()
+        if ret.strip() in ("else", "return") or name in ("if", "for", "while", "switch"):
+            continue
+        result.append("%s %s(%s);" % (ret.strip(), name, args))
+    return "\n".join(result)
+
+
+def sketch_source(test):
+    tabs = [os.path.join(SKETCH_DIR, "DAK.ino")]
+    tabs += sorted(f for f in glob.glob(os.path.join(SKETCH_DIR, "*.ino")) if os.path.basename(f) != "DAK.ino")
+
+    lines = []
+    for tab in tabs:
+        lines.append('#line 1 "%s"' % os.path.abspath(tab))
+        lines += open(tab, encoding="utf-8").read().split("\n")
+    source = "\n".join(lines)
+
+    last_include = max(i for i, line in enumerate(lines) if line.startswith("#include"))
+    lines.insert(last_include + 1, prototypes(source))
+    lines.insert(0, '#include "Arduino.h"')
+    lines.append('#include "sim.h"')
+    lines.append('#include "%s"' % os.path.abspath(test))
+    return "\n".join(lines)
+
+
+def build_and_run(test, build_dir):
+    text = open(test, encoding="utf-8").read()
+    flags = " ".join(re.findall(r"^// SKETCH_FLAGS:(.*)$", text, flags=re.M)).split()
+    combos = "\n".join(c.strip() for c in re.findall(r"^// SKETCH_COMBOS:(.*)$", text, flags=re.M))
+    keys = re.findall(r"^// SKETCH_LAYOUT:\s*(K\d+)\s+(.*)$", text, flags=re.M)
+
+    source = sketch_source(test)
+    name = os.path.splitext(os.path.basename(test))[0]
+
+    # The layout is read from a copy, so that the combos of the test can be added.
+    sketch_copy = os.path.join(build_dir, name)
+    os.makedirs(sketch_copy, exist_ok=True)
+    for header in glob.glob(os.path.join(SKETCH_DIR, "*.h")):
+        content = open(header, encoding="utf-8").read()
+        if os.path.basename(header).startswith("layout_config"):
+            if combos:
+                content = content.replace("//{C1},", combos)
+            for key, definition in keys:
+                content, found = re.subn(r"^#define %s .*$" % key, lambda m: "#define %s  %s" % (key, definition.strip()),
+                                         content, flags=re.M)
+                if found != 1:
+                    raise SystemExit("%s: %s is not defined in %s" % (name, key, os.path.basename(header)))
+        open(os.path.join(sketch_copy, os.path.basename(header)), "w", encoding="utf-8").write(content)
+
+    cpp = os.path.join(build_dir, name + ".cpp")
+    binary = os.path.join(build_dir, name + ".bin")
+    open(cpp, "w", encoding="utf-8").write(source)
+
+    command = [CXX] + CXXFLAGS + flags + ["-I", sketch_copy, "-I", os.path.join(TEST_DIR, "stub"), "-I", TEST_DIR,
+                                         "-o", binary, cpp]
+    if subprocess.call(command) != 0:
+        print("FAIL %s: build failed" % name)
+        return False
+
+    print("== %s %s" % (name, " ".join(flags)), flush=True)
+    return subprocess.call([binary]) == 0
+
+
+def main():
+    names = sys.argv[1:]
+    tests = sorted(glob.glob(os.path.join(TEST_DIR, "test_*.cpp")))
+    if names:
+        tests = [t for t in tests if os.path.splitext(os.path.basename(t))[0] in names]
+
+    failed = []
+    with tempfile.TemporaryDirectory() as build_dir:
+        for test in tests:
+            if not build_and_run(test, build_dir):
+                failed.append(os.path.basename(test))
+
+    print("\n%d test files, %d failed %s" % (len(tests), len(failed), " ".join(failed)))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
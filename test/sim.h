@@ -0,0 +1,217 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    sim.h - simulated hardware and helpers for the host tests, included after the sketch.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+The time only advances in sim_run(), which calls loop() every sim_loop_time us.
+The switches are set with sim_switch() and everything the keyboard sends to the
+host is recorded as text events:
+  "down 0x0D" / "up 0x0D"   key in the keyboard report (Teensy key code & 0xFF)
+  "mod 0x02"                modifiers of the keyboard report changed
+  "press 0xE4E9" / "release 0xE4E9"   Keyboard.press() / release() (media and system keys)
+  "move x y wheel horiz"    mouse report
+  "click 1" / "unclick 1"   mouse buttons
+*/
+
+#ifdef USE_COLUMN_MUX
+#error "The host tests simulate a keyboard without the column mux"
+#endif
+
+#include <string>
+#include <vector>
+
+unsigned long sim_time_us = 0;
+unsigned long sim_loop_time = 350;       // us, loop time of a Teensy 3.2 at 72 MHz
+uint8_t sim_switches[ROWS][COLUMNS];
+int sim_column = -1;                     // Active column
+std::vector<std::string> sim_events;
+std::string sim_serial_in, sim_serial_out;
+int sim_serial_space = 64;               // Serial.availableForWrite()
+int sim_failures = 0;
+
+volatile uint8_t keyboard_leds = 0;
+usb_keyboard_class Keyboard;
+usb_mouse_class Mouse;
+usb_serial_class Serial;
+EEPROMClass EEPROM;
+
+uint8_t sim_report_keys[7];
+uint8_t sim_report_modifiers = 0;
+uint8_t sim_sent_keys[7];
+uint8_t sim_sent_modifiers = 0;
+
+std::string sim_format(const char *format, long a, long b = 0, long c = 0, long d = 0) {
+  char text[64];
+  snprintf(text, sizeof(text), format, a, b, c, d);
+  return text;
+}
+
+unsigned long micros() { return sim_time_us; }
+unsigned long millis() { return sim_time_us / 1000; }
+void delay(unsigned long ms) { sim_time_us += ms * 1000; }
+void pinMode(uint8_t, uint8_t) {}
+int analogRead(uint8_t) { return 0; }
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  for (int c = 0; c < COLUMNS; c++) {
+    if (COLUMN_PINS[c] == pin) {
+      sim_column = value ? c : (sim_column == c ? -1 : sim_column);
+    }
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  for (int r = 0; r < ROWS; r++) {
+    if (ROW_PINS[r] == pin && sim_column >= 0) {
+      return sim_switches[r][sim_column];
+    }
+  }
+  return 0;
+}
+
+void usb_keyboard_class::set_key1(uint8_t k) { sim_report_keys[1] = k; }
+void usb_keyboard_class::set_key2(uint8_t k) { sim_report_keys[2] = k; }
+void usb_keyboard_class::set_key3(uint8_t k) { sim_report_keys[3] = k; }
+void usb_keyboard_class::set_key4(uint8_t k) { sim_report_keys[4] = k; }
+void usb_keyboard_class::set_key5(uint8_t k) { sim_report_keys[5] = k; }
+void usb_keyboard_class::set_key6(uint8_t k) { sim_report_keys[6] = k; }
+void usb_keyboard_class::set_modifier(uint16_t m) { sim_report_modifiers = m & 0xFF; }
+
+bool sim_keys_contain(const uint8_t *keys, uint8_t key) {
+  for (int n = 1; n <= 6; n++) {
+    if (keys[n] == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void usb_keyboard_class::send_now() {
+  for (int n = 1; n <= 6; n++) {
+    if (sim_sent_keys[n] != 0 && !sim_keys_contain(sim_report_keys, sim_sent_keys[n])) {
+      sim_events.push_back(sim_format("up 0x%02lX", sim_sent_keys[n]));
+    }
+  }
+  for (int n = 1; n <= 6; n++) {
+    if (sim_report_keys[n] != 0 && !sim_keys_contain(sim_sent_keys, sim_report_keys[n])) {
+      sim_events.push_back(sim_format("down 0x%02lX", sim_report_keys[n]));
+    }
+  }
+  if (sim_report_modifiers != sim_sent_modifiers) {
+    sim_events.push_back(sim_format("mod 0x%02lX", sim_report_modifiers));
+  }
+  memcpy(sim_sent_keys, sim_report_keys, sizeof(sim_sent_keys));
+  sim_sent_modifiers = sim_report_modifiers;
+}
+
+size_t usb_keyboard_class::press(uint16_t k) { sim_events.push_back(sim_format("press 0x%04lX", k)); return 1; }
+size_t usb_keyboard_class::release(uint16_t k) { sim_events.push_back(sim_format("release 0x%04lX", k)); return 1; }
+
+void usb_keyboard_class::releaseAll() {
+  memset(sim_report_keys, 0, sizeof(sim_report_keys));
+  sim_report_modifiers = 0;
+  send_now();
+}
+
+void usb_mouse_class::move(int8_t x, int8_t y, int8_t wheel, int8_t horiz) {
+  sim_events.push_back(sim_format("move %ld %ld %ld %ld", x, y, wheel, horiz));
+}
+void usb_mouse_class::press(uint8_t b) { sim_events.push_back(sim_format("click %ld", b)); }
+void usb_mouse_class::release(uint8_t b) { sim_events.push_back(sim_format("unclick %ld", b)); }
+
+void usb_serial_class::begin(long) {}
+int usb_serial_class::available() { return sim_serial_in.size(); }
+int usb_serial_class::availableForWrite() { return sim_serial_space; }
+
+int usb_serial_class::read() {
+  if (sim_serial_in.empty()) {
+    return -1;
+  }
+  int c = (uint8_t)sim_serial_in[0];
+  sim_serial_in.erase(0, 1);
+  return c;
+}
+
+void sim_serial_output(const char *text, size_t length) { sim_serial_out.append(text, length); }
+
+// Helpers for the tests
+
+void sim_switch(struct Rc pos, uint8_t state) { sim_switches[pos.r][pos.c] = state; }
+
+// Runs the loop for the given time (ms).
+void sim_run(unsigned long ms) {
+  unsigned long end = sim_time_us + ms * 1000;
+  while ((long)(sim_time_us - end) < 0) {
+    loop();
+    sim_time_us += sim_loop_time;
+  }
+}
+
+// Starts the keyboard and clears the events of the startup.
+void sim_start() {
+  setup();
+  sim_run(100);
+  sim_events.clear();
+}
+
+int sim_count(const std::string &event) {
+  int n = 0;
+  for (const std::string &e : sim_events) {
+    n += e == event;
+  }
+  return n;
+}
+
+// Index of the first event, -1 if not found.
+int sim_find(const std::string &event) {
+  for (size_t n = 0; n < sim_events.size(); n++) {
+    if (sim_events[n] == event) {
+      return n;
+    }
+  }
+  return -1;
+}
+
+std::string sim_key(uint16_t key_code) { return sim_format("0x%02lX", key_code & 0xFF); }
+std::string sim_down(uint16_t key_code) { return "down " + sim_key(key_code); }
+std::string sim_up(uint16_t key_code) { return "up " + sim_key(key_code); }
+std::string sim_press(uint16_t key_code) { return sim_format("press 0x%04lX", key_code); }
+std::string sim_release(uint16_t key_code) { return sim_format("release 0x%04lX", key_code); }
+bool sim_key_is_down(uint16_t key_code) { return sim_keys_contain(sim_sent_keys, key_code & 0xFF); }
+
+void sim_print_events() {
+  for (const std::string &e : sim_events) {
+    printf("    %s\n", e.c_str());
+  }
+}
+
+#define CHECK(condition) do { \
+  if (!(condition)) { \
+    printf("%s:%d: %s: CHECK(%s) failed, events:\n", __FILE__, __LINE__, __func__, #condition); \
+    sim_print_events(); \
+    sim_failures++; \
+  } \
+} while (0)
+
+#define RUN_TEST(test) do { \
+  int failures = sim_failures; \
+  sim_events.clear(); \
+  test(); \
+  printf("%s %s\n", sim_failures > failures ? "FAIL" : "ok  ", #test); \
+} while (0)
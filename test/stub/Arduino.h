@@ -0,0 +1,211 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    Arduino.h - declarations of the Teensyduino API used by the sketch, for the host tests.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARDUINO_STUB
+#define ARDUINO_STUB
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#define HIGH   1
+#define LOW    0
+#define INPUT  0
+#define OUTPUT 1
+#define HEX    16
+#define DEC    10
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+int analogRead(uint8_t pin);
+void pinMode(uint8_t pin, uint8_t mode);
+
+// Keyboard LEDs set by the host
+extern volatile uint8_t keyboard_leds;
+#define USB_LED_NUM_LOCK    0
+#define USB_LED_CAPS_LOCK   1
+#define USB_LED_SCROLL_LOCK 2
+#define USB_LED_COMPOSE     3
+#define USB_LED_KANA        4
+
+class usb_keyboard_class {
+public:
+  void set_key1(uint8_t k);
+  void set_key2(uint8_t k);
+  void set_key3(uint8_t k);
+  void set_key4(uint8_t k);
+  void set_key5(uint8_t k);
+  void set_key6(uint8_t k);
+  void set_modifier(uint16_t m);
+  void send_now();
+  size_t press(uint16_t k);
+  size_t release(uint16_t k);
+  void releaseAll();
+};
+extern usb_keyboard_class Keyboard;
+
+#define MOUSE_LEFT   1
+#define MOUSE_MIDDLE 4
+#define MOUSE_RIGHT  2
+
+class usb_mouse_class {
+public:
+  void move(int8_t x, int8_t y, int8_t wheel = 0, int8_t horiz = 0);
+  void press(uint8_t b = MOUSE_LEFT);
+  void release(uint8_t b = MOUSE_LEFT);
+};
+extern usb_mouse_class Mouse;
+
+// Text output of the serial port, binary writes go to the same stream.
+void sim_serial_output(const char *text, size_t length);
+
+class usb_serial_class {
+public:
+  void begin(long baud);
+  int available();
+  int read();
+  int availableForWrite();
+  operator bool() { return true; } // Serial port open
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t *buffer, size_t size) { sim_serial_output((const char *)buffer, size); return size; }
+  size_t print(const char *s) { sim_serial_output(s, strlen(s)); return strlen(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long n, int base = DEC) { return print_number(n, base); }
+  size_t print(unsigned long n, int base = DEC) { return print_number(n, base); }
+  size_t print(int n, int base = DEC) { return print_number(n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print_number(n, base); }
+  size_t println() { return print("\n"); }
+  template <class T> size_t println(T value) { size_t n = print(value); return n + println(); }
+  template <class T> size_t println(T value, int base) { size_t n = print(value, base); return n + println(); }
+private:
+  size_t print_number(long long n, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%llX" : "%lld", n);
+    return print(text);
+  }
+};
+extern usb_serial_class Serial;
+
+// Key codes, same values as in keylayouts.h of Teensyduino
+#define MODIFIERKEY_CTRL        (0x01 | 0xE000)
+#define MODIFIERKEY_SHIFT       (0x02 | 0xE000)
+#define MODIFIERKEY_ALT         (0x04 | 0xE000)
+#define MODIFIERKEY_GUI         (0x08 | 0xE000)
+#define MODIFIERKEY_RIGHT_CTRL  (0x10 | 0xE000)
+#define MODIFIERKEY_RIGHT_SHIFT (0x20 | 0xE000)
+#define MODIFIERKEY_RIGHT_ALT   (0x40 | 0xE000)
+#define MODIFIERKEY_RIGHT_GUI   (0x80 | 0xE000)
+
+#define KEY_SYSTEM_POWER_DOWN   (0x81 | 0xE200)
+#define KEY_SYSTEM_SLEEP        (0x82 | 0xE200)
+#define KEY_SYSTEM_WAKE_UP      (0x83 | 0xE200)
+
+#define KEY_MEDIA_PLAY          (0xB0 | 0xE400)
+#define KEY_MEDIA_PAUSE         (0xB1 | 0xE400)
+#define KEY_MEDIA_NEXT_TRACK    (0xB5 | 0xE400)
+#define KEY_MEDIA_PREV_TRACK    (0xB6 | 0xE400)
+#define KEY_MEDIA_MUTE          (0xE2 | 0xE400)
+#define KEY_MEDIA_VOLUME_INC    (0xE9 | 0xE400)
+#define KEY_MEDIA_VOLUME_DEC    (0xEA | 0xE400)
+
+#define KEY_A           (  4 | 0xF000)
+#define KEY_B           (  5 | 0xF000)
+#define KEY_C           (  6 | 0xF000)
+#define KEY_D           (  7 | 0xF000)
+#define KEY_E           (  8 | 0xF000)
+#define KEY_F           (  9 | 0xF000)
+#define KEY_G           ( 10 | 0xF000)
+#define KEY_H           ( 11 | 0xF000)
+#define KEY_I           ( 12 | 0xF000)
+#define KEY_J           ( 13 | 0xF000)
+#define KEY_K           ( 14 | 0xF000)
+#define KEY_L           ( 15 | 0xF000)
+#define KEY_M           ( 16 | 0xF000)
+#define KEY_N           ( 17 | 0xF000)
+#define KEY_O           ( 18 | 0xF000)
+#define KEY_P           ( 19 | 0xF000)
+#define KEY_Q           ( 20 | 0xF000)
+#define KEY_R           ( 21 | 0xF000)
+#define KEY_S           ( 22 | 0xF000)
+#define KEY_T           ( 23 | 0xF000)
+#define KEY_U           ( 24 | 0xF000)
+#define KEY_V           ( 25 | 0xF000)
+#define KEY_W           ( 26 | 0xF000)
+#define KEY_X           ( 27 | 0xF000)
+#define KEY_Y           ( 28 | 0xF000)
+#define KEY_Z           ( 29 | 0xF000)
+#define KEY_1           ( 30 | 0xF000)
+#define KEY_2           ( 31 | 0xF000)
+#define KEY_3           ( 32 | 0xF000)
+#define KEY_4           ( 33 | 0xF000)
+#define KEY_5           ( 34 | 0xF000)
+#define KEY_6           ( 35 | 0xF000)
+#define KEY_7           ( 36 | 0xF000)
+#define KEY_8           ( 37 | 0xF000)
+#define KEY_9           ( 38 | 0xF000)
+#define KEY_0           ( 39 | 0xF000)
+#define KEY_ENTER       ( 40 | 0xF000)
+#define KEY_ESC         ( 41 | 0xF000)
+#define KEY_BACKSPACE   ( 42 | 0xF000)
+#define KEY_TAB         ( 43 | 0xF000)
+#define KEY_SPACE       ( 44 | 0xF000)
+#define KEY_MINUS       ( 45 | 0xF000)
+#define KEY_EQUAL       ( 46 | 0xF000)
+#define KEY_LEFT_BRACE  ( 47 | 0xF000)
+#define KEY_RIGHT_BRACE ( 48 | 0xF000)
+#define KEY_BACKSLASH   ( 49 | 0xF000)
+#define KEY_SEMICOLON   ( 51 | 0xF000)
+#define KEY_QUOTE       ( 52 | 0xF000)
+#define KEY_TILDE       ( 53 | 0xF000)
+#define KEY_COMMA       ( 54 | 0xF000)
+#define KEY_PERIOD      ( 55 | 0xF000)
+#define KEY_SLASH       ( 56 | 0xF000)
+#define KEY_CAPS_LOCK   ( 57 | 0xF000)
+#define KEY_F1          ( 58 | 0xF000)
+#define KEY_F2          ( 59 | 0xF000)
+#define KEY_F3          ( 60 | 0xF000)
+#define KEY_F4          ( 61 | 0xF000)
+#define KEY_F5          ( 62 | 0xF000)
+#define KEY_F6          ( 63 | 0xF000)
+#define KEY_F7          ( 64 | 0xF000)
+#define KEY_F8          ( 65 | 0xF000)
+#define KEY_F9          ( 66 | 0xF000)
+#define KEY_F10         ( 67 | 0xF000)
+#define KEY_F11         ( 68 | 0xF000)
+#define KEY_F12         ( 69 | 0xF000)
+#define KEY_PRINTSCREEN ( 70 | 0xF000)
+#define KEY_INSERT      ( 73 | 0xF000)
+#define KEY_HOME        ( 74 | 0xF000)
+#define KEY_PAGE_UP     ( 75 | 0xF000)
+#define KEY_DELETE      ( 76 | 0xF000)
+#define KEY_END         ( 77 | 0xF000)
+#define KEY_PAGE_DOWN   ( 78 | 0xF000)
+#define KEY_RIGHT       ( 79 | 0xF000)
+#define KEY_LEFT        ( 80 | 0xF000)
+#define KEY_DOWN        ( 81 | 0xF000)
+#define KEY_UP          ( 82 | 0xF000)
+#define KEY_NON_US_BS   (100 | 0xF000)
+#define KEY_MENU        (101 | 0xF000)
+
+#endif
@@ -0,0 +1,53 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    EEPROM.h - EEPROM of a Teensy 3.2 (2 kB) in RAM, for the host tests.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EEPROM_STUB
+#define EEPROM_STUB
+
+#include "Arduino.h"
+
+#define E2END 0x7FF
+
+class EEPROMClass {
+public:
+  uint8_t memory[E2END + 1];
+  uint32_t writes = 0; // Number of bytes actually written
+  uint16_t size = E2END + 1; // Returned by length(), can be set smaller
+  long writes_left = -1; // The power is lost after this many writes, -1 = never
+
+  EEPROMClass() { memset(memory, 0xFF, sizeof(memory)); } // Erased
+  uint8_t read(int address) { return memory[address]; }
+  void update(int address, uint8_t value) { if (memory[address] != value) write(address, value); }
+  uint16_t length() { return size; }
+
+  void write(int address, uint8_t value) {
+    if (writes_left == 0) {
+      return;
+    }
+    if (writes_left > 0) {
+      writes_left--;
+    }
+    memory[address] = value;
+    writes++;
+  }
+};
+extern EEPROMClass EEPROM;
+
+#endif
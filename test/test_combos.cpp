@@ -0,0 +1,245 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    test_combos.cpp - host tests of the combo engine (combos.ino).
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// J+K -> ESC and J+K+L -> ENTER overlap, K2 (2. switch of the DOUBLE_ACTION key K) + Ö -> CTRL+TAB
+// SKETCH_COMBOS: {L1,50,KEY_ESC,0,2,{B38A,B39A}},
+// SKETCH_COMBOS: {L1,50,KEY_ENTER,0,3,{B38A,B39A,B40A}},
+// SKETCH_COMBOS: {L1,50,KEY_TAB,MODIFIERKEY_CTRL,2,{B39B,B41A}},
+// PAGE UP + HOME -> END, DELETE is before PAGE UP in the layout
+// SKETCH_COMBOS: {L1,50,KEY_END,0,2,{B21A,B22A}},
+
+const struct Rc SWITCH_J = B38A;
+const struct Rc SWITCH_K = B39A;
+const struct Rc SWITCH_K2 = B39B;
+const struct Rc SWITCH_L = B40A;
+const struct Rc SWITCH_OE = B41A;
+const struct Rc SWITCH_FN = B58A;
+const struct Rc SWITCH_PAGE_UP = B21A;
+const struct Rc SWITCH_DELETE = B14A;
+
+// Releases all switches and checks that nothing was left pressed.
+void release_all() {
+  memset(sim_switches, 0, sizeof(sim_switches));
+  sim_run(100);
+  for (int n = 1; n <= 6; n++) {
+    CHECK(sim_sent_keys[n] == 0);
+  }
+  CHECK(sim_sent_modifiers == 0);
+  CHECK(active_combos == 0 && !combo_is_pending);
+}
+
+void test_two_switch_combo() {
+  sim_switch(SWITCH_J, 1);
+  sim_run(10);
+  sim_switch(SWITCH_K, 1);
+  sim_run(100); // Longer than the term, J+K+L can't be completed anymore
+
+  CHECK(sim_key_is_down(KEY_ESC));
+  CHECK(sim_count(sim_down(KEY_J)) == 0 && sim_count(sim_down(KEY_K)) == 0);
+
+  sim_switch(SWITCH_J, 0);
+  sim_run(20);
+  CHECK(sim_count(sim_up(KEY_ESC)) == 1);
+
+  release_all();
+  CHECK(sim_count(sim_down(KEY_J)) == 0 && sim_count(sim_down(KEY_K)) == 0);
+}
+
+void test_overlapping_combo_with_more_switches_wins() {
+  sim_switch(SWITCH_J, 1);
+  sim_run(5);
+  sim_switch(SWITCH_K, 1);
+  sim_run(5);
+  sim_switch(SWITCH_L, 1);
+  sim_run(20); // All switches of J+K+L pressed -> no need to wait for the term
+
+  CHECK(sim_key_is_down(KEY_ENTER));
+  CHECK(sim_count(sim_down(KEY_ESC)) == 0);
+
+  release_all();
+  CHECK(sim_count(sim_down(KEY_ENTER)) == 1);
+  CHECK(sim_count(sim_down(KEY_ESC)) == 0 && sim_count(sim_down(KEY_J)) == 0 &&
+    sim_count(sim_down(KEY_K)) == 0 && sim_count(sim_down(KEY_L)) == 0);
+}
+
+void test_release_before_term() {
+  // J is released before K is pressed -> normal key stroke.
+  sim_switch(SWITCH_J, 1);
+  sim_run(20);
+  sim_switch(SWITCH_J, 0);
+  sim_run(50);
+
+  CHECK(sim_count(sim_down(KEY_J)) == 1 && sim_count(sim_up(KEY_J)) == 1);
+
+  // J+K pressed, K released before the term -> both as normal key strokes in order.
+  sim_events.clear();
+  sim_switch(SWITCH_J, 1);
+  sim_run(5);
+  sim_switch(SWITCH_K, 1);
+  sim_run(10);
+  sim_switch(SWITCH_K, 0);
+  sim_run(30);
+  sim_switch(SWITCH_J, 0);
+  release_all();
+
+  CHECK(sim_count(sim_down(KEY_ESC)) == 0 && sim_count(sim_down(KEY_ENTER)) == 0);
+  CHECK(sim_count(sim_down(KEY_J)) == 1 && sim_count(sim_down(KEY_K)) == 1);
+}
+
+void test_term_timeout() {
+  // J alone is held back for the term only, then it works like without combos.
+  sim_switch(SWITCH_J, 1);
+  sim_run(49);
+  CHECK(combo_is_pending);
+  sim_run(10);
+  CHECK(!combo_is_pending);
+
+  sim_run(DELAY_TIME); // DOUBLE_ACTION key held -> 1. action
+  CHECK(sim_key_is_down(KEY_J));
+
+  // K pressed after the term is not a combo.
+  sim_switch(SWITCH_K, 1);
+  sim_run(100);
+  CHECK(sim_count(sim_down(KEY_ESC)) == 0);
+
+  release_all();
+  CHECK(sim_count(sim_down(KEY_J)) == 1);
+}
+
+void test_combo_on_second_switch_of_double_action_key() {
+  sim_switch(SWITCH_K, 1);
+  sim_run(20);
+  sim_switch(SWITCH_K2, 1);
+  sim_run(5);
+  sim_switch(SWITCH_OE, 1);
+  sim_run(30);
+
+  CHECK(sim_key_is_down(KEY_TAB));
+  CHECK(sim_sent_modifiers == (MODIFIERKEY_CTRL & 0xFF));
+  CHECK(sim_count(sim_down(KEY_5)) == 0 && sim_count(sim_down(KEY_K)) == 0 && sim_count(sim_down(KEY_SEMICOLON)) == 0);
+
+  release_all();
+  CHECK(sim_count(sim_down(KEY_5)) == 0 && sim_count(sim_down(KEY_K)) == 0 && sim_count(sim_down(KEY_SEMICOLON)) == 0);
+}
+
+void test_layer_change_while_pending() {
+  sim_switch(SWITCH_J, 1);
+  sim_run(10);
+  CHECK(combo_is_pending);
+
+  sim_switch(SWITCH_FN, 1);
+  sim_run(20);
+  CHECK(!combo_is_pending);
+  CHECK(keyboard_layer == L2);
+
+  sim_switch(SWITCH_K, 1); // Not a combo on the FN layer
+  sim_run(100);
+  CHECK(sim_count(sim_down(KEY_ESC)) == 0);
+
+  release_all();
+  CHECK(keyboard_layer == L1);
+}
+
+void test_layer_change_while_active() {
+  sim_switch(SWITCH_J, 1);
+  sim_run(5);
+  sim_switch(SWITCH_K, 1);
+  sim_run(100);
+  CHECK(sim_key_is_down(KEY_ESC));
+
+  sim_switch(SWITCH_FN, 1);
+  sim_run(20);
+  CHECK(!sim_key_is_down(KEY_ESC));
+  CHECK(active_combos == 0);
+
+  release_all();
+  CHECK(sim_count(sim_down(KEY_ESC)) == 1);
+  CHECK(sim_count(sim_down(KEY_J)) == 0 && sim_count(sim_down(KEY_K)) == 0);
+}
+
+void test_bounce_of_held_switch() {
+  // A held back switch is still debounced: a short drop doesn't release it.
+  uint16_t bounces = switch_stats[SWITCH_J.r][SWITCH_J.c].bounces;
+
+  sim_switch(SWITCH_J, 1);
+  sim_run(10);
+  sim_switch(SWITCH_J, 0);
+  sim_run(1);
+  sim_switch(SWITCH_J, 1);
+  sim_run(10);
+  sim_switch(SWITCH_K, 1);
+  sim_run(100);
+
+  CHECK(sim_key_is_down(KEY_ESC));
+  CHECK(sim_count(sim_down(KEY_J)) == 0 && sim_count(sim_down(KEY_K)) == 0);
+  CHECK(switch_stats[SWITCH_J.r][SWITCH_J.c].bounces == bounces + 1);
+
+  release_all();
+  CHECK(sim_count(sim_down(KEY_J)) == 0 && sim_count(sim_down(KEY_K)) == 0);
+}
+
+void test_order_of_held_and_normal_switch() {
+  // PAGE UP is held for the combo, DELETE is not part of any combo -> PAGE UP is sent first.
+  sim_switch(SWITCH_PAGE_UP, 1);
+  sim_run(10);
+  sim_switch(SWITCH_DELETE, 1);
+  sim_run(20);
+
+  CHECK(sim_key_is_down(KEY_PAGE_UP) && sim_key_is_down(KEY_DELETE));
+  CHECK(sim_find(sim_down(KEY_PAGE_UP)) >= 0 && sim_find(sim_down(KEY_PAGE_UP)) < sim_find(sim_down(KEY_DELETE)));
+
+  release_all();
+  CHECK(sim_count(sim_down(KEY_END)) == 0);
+}
+
+void test_clean_presses_are_not_bounces() {
+  // Held switches and normal switches record no bounces without one.
+  uint16_t bounces_j = switch_stats[SWITCH_J.r][SWITCH_J.c].bounces;
+  uint16_t bounces_delete = switch_stats[SWITCH_DELETE.r][SWITCH_DELETE.c].bounces;
+
+  sim_switch(SWITCH_J, 1);
+  sim_run(20);
+  sim_switch(SWITCH_J, 0);
+  sim_run(50);
+  sim_switch(SWITCH_DELETE, 1);
+  sim_run(20);
+  sim_switch(SWITCH_DELETE, 0);
+  release_all();
+
+  CHECK(switch_stats[SWITCH_J.r][SWITCH_J.c].bounces == bounces_j);
+  CHECK(switch_stats[SWITCH_DELETE.r][SWITCH_DELETE.c].bounces == bounces_delete);
+}
+
+int main() {
+  sim_start();
+
+  RUN_TEST(test_two_switch_combo);
+  RUN_TEST(test_overlapping_combo_with_more_switches_wins);
+  RUN_TEST(test_release_before_term);
+  RUN_TEST(test_term_timeout);
+  RUN_TEST(test_combo_on_second_switch_of_double_action_key);
+  RUN_TEST(test_layer_change_while_pending);
+  RUN_TEST(test_layer_change_while_active);
+  RUN_TEST(test_bounce_of_held_switch);
+  RUN_TEST(test_order_of_held_and_normal_switch);
+  RUN_TEST(test_clean_presses_are_not_bounces);
+
+  return sim_failures != 0;
+}
@@ -0,0 +1,170 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    test_media_keys.cpp - host tests of the media and system keys (media_keys.ino).
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Volume up on the FN layer of F, a DOUBLE_ACTION key.
+// SKETCH_LAYOUT: K33 DOUBLE_ACTION,DOUBLE_ACTION,{KEY_F,KEY_9,KEY_MEDIA_VOLUME_INC,0},{0,SHIFT,0,0},B33A,B33B
+
+const struct Rc SWITCH_FN = B58A;
+const struct Rc SWITCH_VOLUME_INC = B45A; // X, volume up on the FN layer
+const struct Rc SWITCH_MUTE = B46A;       // C, mute on the FN layer
+const struct Rc SWITCH_A = B30A;
+const struct Rc SWITCH_F = B33A;
+
+void release_all() {
+  memset(sim_switches, 0, sizeof(sim_switches));
+  sim_run(100);
+  CHECK(active_media_keys == 0);
+  for (int n = 1; n <= 6; n++) {
+    CHECK(sim_sent_keys[n] == 0);
+  }
+}
+
+void test_volume_repeats_at_firmware_rate() {
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_events.clear();
+
+  sim_switch(SWITCH_VOLUME_INC, 1);
+  sim_run(1000);
+
+  // Pulses when pressed, after MEDIA_REPEAT_DELAY and then every MEDIA_REPEAT_INTERVAL.
+  int pulses = 1 + (1000 - MEDIA_REPEAT_DELAY) / MEDIA_REPEAT_INTERVAL;
+  CHECK(pulses == 7);
+  CHECK(sim_count(sim_press(KEY_MEDIA_VOLUME_INC)) == pulses);
+  CHECK(sim_count(sim_release(KEY_MEDIA_VOLUME_INC)) == pulses);
+
+  // Each pulse is a press followed by a release, nothing is sent in the keyboard report.
+  for (size_t n = 0; n < sim_events.size(); n++) {
+    CHECK(sim_events[n] == (n % 2 ? sim_release(KEY_MEDIA_VOLUME_INC) : sim_press(KEY_MEDIA_VOLUME_INC)));
+  }
+
+  sim_switch(SWITCH_VOLUME_INC, 0);
+  sim_run(50);
+  sim_events.clear();
+  sim_run(500);
+  CHECK(sim_events.empty()); // No repeats after the release
+
+  release_all();
+}
+
+void test_mute_is_not_repeated() {
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_events.clear();
+
+  sim_switch(SWITCH_MUTE, 1);
+  sim_run(1000);
+  CHECK(sim_count(sim_press(KEY_MEDIA_MUTE)) == 1);
+  CHECK(sim_count(sim_release(KEY_MEDIA_MUTE)) == 0);
+
+  sim_switch(SWITCH_MUTE, 0);
+  sim_run(50);
+  CHECK(sim_count(sim_release(KEY_MEDIA_MUTE)) == 1);
+
+  release_all();
+}
+
+void test_short_tap_is_sent() {
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_events.clear();
+
+  sim_switch(SWITCH_MUTE, 1);
+  sim_run(10);
+  sim_switch(SWITCH_MUTE, 0);
+  sim_run(50);
+  CHECK(sim_count(sim_press(KEY_MEDIA_MUTE)) == 1 && sim_count(sim_release(KEY_MEDIA_MUTE)) == 1);
+
+  release_all();
+}
+
+void test_fn_released_while_media_key_held() {
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_switch(SWITCH_MUTE, 1);
+  sim_run(200);
+  CHECK(sim_count(sim_press(KEY_MEDIA_MUTE)) == 1);
+
+  sim_switch(SWITCH_FN, 0);
+  sim_run(50);
+  CHECK(sim_count(sim_release(KEY_MEDIA_MUTE)) == 1);
+  CHECK(active_media_keys == 0);
+
+  release_all();
+  CHECK(sim_count(sim_press(KEY_MEDIA_MUTE)) == 1); // Not pressed again on the normal layer
+}
+
+void test_typing_while_volume_held() {
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_switch(SWITCH_VOLUME_INC, 1);
+  sim_run(50);
+  sim_switch(SWITCH_FN, 0); // Releases the volume key
+  sim_run(50);
+  sim_events.clear();
+
+  sim_switch(SWITCH_A, 1);
+  sim_run(DELAY_TIME + 50);
+  CHECK(sim_key_is_down(KEY_A));
+  CHECK(sim_count(sim_press(KEY_MEDIA_VOLUME_INC)) == 0);
+
+  release_all();
+}
+
+void test_media_key_on_double_action_key() {
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_events.clear();
+
+  // Held: pressed once after DELAY_TIME, then repeated by the firmware (at 800 and 900 ms).
+  sim_switch(SWITCH_F, 1);
+  sim_run(950);
+  sim_switch(SWITCH_F, 0);
+  sim_run(50);
+
+  int pulses = 1 + (950 - DELAY_TIME - MEDIA_REPEAT_DELAY + MEDIA_REPEAT_INTERVAL - 1) / MEDIA_REPEAT_INTERVAL;
+  CHECK(pulses == 3);
+  CHECK(sim_count(sim_press(KEY_MEDIA_VOLUME_INC)) == pulses);
+  CHECK(sim_count(sim_release(KEY_MEDIA_VOLUME_INC)) == pulses);
+
+  // Tapped: one pulse when released.
+  sim_events.clear();
+  sim_switch(SWITCH_F, 1);
+  sim_run(50);
+  sim_switch(SWITCH_F, 0);
+  sim_run(100);
+  CHECK(sim_count(sim_press(KEY_MEDIA_VOLUME_INC)) == 1);
+  CHECK(sim_count(sim_release(KEY_MEDIA_VOLUME_INC)) == 1);
+
+  release_all();
+}
+
+int main() {
+  sim_start();
+
+  RUN_TEST(test_volume_repeats_at_firmware_rate);
+  RUN_TEST(test_mute_is_not_repeated);
+  RUN_TEST(test_short_tap_is_sent);
+  RUN_TEST(test_fn_released_while_media_key_held);
+  RUN_TEST(test_typing_while_volume_held);
+  RUN_TEST(test_media_key_on_double_action_key);
+
+  return sim_failures != 0;
+}
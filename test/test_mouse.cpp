@@ -0,0 +1,194 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    test_mouse.cpp - host tests of the mouse actions (mouse.ino).
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// SKETCH_FLAGS: -DMOUSE_KEYS
+// Mouse right on the FN layer of F, a DOUBLE_ACTION key.
+// SKETCH_LAYOUT: K33 DOUBLE_ACTION,DOUBLE_ACTION,{KEY_F,KEY_9,MOUSE_MOVE_RIGHT,0},{0,SHIFT,0,0},B33A,B33B
+
+#include <math.h>
+
+const struct Rc SWITCH_FN = B58A;
+const struct Rc SWITCH_RIGHT = B_right;
+const struct Rc SWITCH_DOWN = B_down;
+const struct Rc SWITCH_CENTER = B_center;
+const struct Rc SWITCH_F = B33A;
+
+// Sum of the mouse reports: x, y, wheel, horizontal wheel and the number of reports.
+struct Motion {
+  long axis[4];
+  int reports;
+  unsigned long time; // ms the movement was held
+};
+
+struct Motion motion() {
+  struct Motion m = {{0, 0, 0, 0}, 0, 0};
+  for (const std::string &e : sim_events) {
+    int x, y, wheel, horiz;
+    if (sscanf(e.c_str(), "move %d %d %d %d", &x, &y, &wheel, &horiz) == 4) {
+      m.axis[0] += x;
+      m.axis[1] += y;
+      m.axis[2] += wheel;
+      m.axis[3] += horiz;
+      m.reports++;
+    }
+  }
+  return m;
+}
+
+// Distance along the curve (pixels) after holding for the given time (ms), as described in layout_config_FI.h.
+double curve_distance(const uint16_t *curve, int length, double time) {
+  double distance = 0;
+  for (double t = 0; t < time; t += 0.1) {
+    int index = t / MOUSE_CURVE_STEP;
+    double speed = index + 1 >= length ? curve[length - 1] :
+      curve[index] + (curve[index + 1] - curve[index]) * (t - index * MOUSE_CURVE_STEP) / MOUSE_CURVE_STEP;
+    distance += speed * 0.1 / 1000;
+  }
+  return distance;
+}
+
+void release_all() {
+  memset(sim_switches, 0, sizeof(sim_switches));
+  sim_run(100);
+  CHECK(mouse_keys == 0);
+  sim_events.clear();
+  sim_loop_time = 350;
+}
+
+// Holds right for the given time and returns the movement.
+struct Motion hold_right(unsigned long ms) {
+  sim_switch(SWITCH_RIGHT, 1);
+  sim_run(ms);
+  struct Motion m = motion();
+  m.time = millis() - mouse_move_time;
+  release_all();
+  return m;
+}
+
+void test_motion_follows_the_curve() {
+  // The first report moves one pixel, then the speed follows mouse_move_curve.
+  struct Motion m = hold_right(1000);
+  double expected = 1 + curve_distance(mouse_move_curve, MOUSE_CURVE_LENGTH(mouse_move_curve), m.time);
+
+  // Within 1 %: the fixed point steps are rounded down to 1/256 pixels and the last fraction is not sent.
+  CHECK(fabs(m.axis[0] - expected) <= expected / 100);
+  CHECK(m.axis[1] == 0 && m.axis[2] == 0 && m.axis[3] == 0);
+}
+
+void test_motion_does_not_depend_on_loop_time() {
+  struct Motion fast = hold_right(800);
+
+  sim_loop_time = 3700; // e.g., a slow scan with debugging
+  struct Motion slow = hold_right(800);
+
+  CHECK(fast.axis[0] > 0);
+  CHECK(labs(fast.axis[0] - slow.axis[0]) <= fast.axis[0] / 50);
+}
+
+void test_report_rate() {
+  // At full speed every report moves the cursor: one report per MOUSE_REPORT_INTERVAL.
+  sim_switch(SWITCH_RIGHT, 1);
+  sim_run(1200);
+  sim_events.clear();
+  sim_run(100);
+  struct Motion m = motion();
+
+  CHECK(m.reports >= 99 && m.reports <= 101);
+  release_all();
+}
+
+void test_long_loop_does_not_stop_the_cursor() {
+  sim_switch(SWITCH_RIGHT, 1);
+  sim_run(1200);
+
+  sim_time_us += 50000; // One loop of 50 ms
+  sim_run(1);
+  sim_events.clear();
+
+  // The reports continue at the normal rate after the long loop.
+  sim_run(5);
+  CHECK(motion().reports >= 4);
+
+  release_all();
+}
+
+void test_scroll_and_click() {
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_switch(SWITCH_DOWN, 1); // Scroll down on the FN layer
+  sim_run(500);
+  sim_switch(SWITCH_DOWN, 0);
+  sim_switch(SWITCH_FN, 0);
+  sim_run(50);
+
+  struct Motion m = motion();
+  CHECK(m.axis[2] < 0 && m.axis[0] == 0 && m.axis[1] == 0);
+  release_all();
+
+  sim_switch(SWITCH_CENTER, 1);
+  sim_run(50);
+  CHECK(sim_count("click 1") == 1);
+  sim_switch(SWITCH_CENTER, 0);
+  sim_run(50);
+  CHECK(sim_count("unclick 1") == 1);
+  release_all();
+
+  // Right click on the FN layer.
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_switch(SWITCH_CENTER, 1);
+  sim_run(50);
+  CHECK(sim_count(sim_format("click %ld", MOUSE_RIGHT)) == 1);
+  sim_switch(SWITCH_CENTER, 0);
+  sim_run(50);
+  CHECK(sim_count(sim_format("unclick %ld", MOUSE_RIGHT)) == 1);
+  CHECK(sim_count("click 1") == 0);
+  release_all();
+}
+
+void test_motion_on_double_action_key() {
+  // The action starts after DELAY_TIME and then follows the curve like on the joystick.
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_events.clear();
+  sim_switch(SWITCH_F, 1);
+  sim_run(DELAY_TIME + 1000);
+
+  struct Motion m = motion();
+  m.time = millis() - mouse_move_time;
+  double expected = 1 + curve_distance(mouse_move_curve, MOUSE_CURVE_LENGTH(mouse_move_curve), m.time);
+
+  CHECK(m.time < 1000 + 20);
+  CHECK(fabs(m.axis[0] - expected) <= expected / 100);
+  release_all();
+}
+
+int main() {
+  sim_start();
+
+  RUN_TEST(test_motion_follows_the_curve);
+  RUN_TEST(test_motion_does_not_depend_on_loop_time);
+  RUN_TEST(test_report_rate);
+  RUN_TEST(test_long_loop_does_not_stop_the_cursor);
+  RUN_TEST(test_scroll_and_click);
+  RUN_TEST(test_motion_on_double_action_key);
+
+  return sim_failures != 0;
+}
@@ -0,0 +1,90 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    test_serial.cpp - host tests of the serial port with the debug log and the text exports.
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// SKETCH_FLAGS: -DDEBUG_PRINT_STATES_ARRAY -DUSAGE_COUNTERS
+
+const struct Rc SWITCH_A = B30A;
+
+// Returns the text export that starts with the header, empty if not found.
+std::string export_text(const std::string &header) {
+  size_t start = sim_serial_out.find(header);
+  if (start == std::string::npos) {
+    return "";
+  }
+  size_t end = sim_serial_out.find("# end\n", start);
+  return end == std::string::npos ? sim_serial_out.substr(start) : sim_serial_out.substr(start, end + 6 - start);
+}
+
+void test_exports_are_not_mixed() {
+  sim_serial_out.clear();
+
+  // The commands are received while typing, when the log has records to send.
+  sim_switch(SWITCH_A, 1);
+  while (debug_log_head == debug_log_tail) {
+    sim_run(1);
+  }
+  sim_serial_in = "us";
+  sim_run(DELAY_TIME + 20);
+  sim_switch(SWITCH_A, 0);
+  sim_run(1000);
+  CHECK(debug_log_head == debug_log_tail && !serial_export_active());
+
+  std::string usage = export_text("# DAK usage,");
+  std::string stats = export_text("# DAK switch stats,");
+
+  // Both exports are complete text without log records (DEBUG_LOG_SYNC), one after the other.
+  CHECK(usage.size() > 0 && usage.find("# end\n") == usage.size() - 6);
+  CHECK(stats.size() > 0 && stats.find("# end\n") == stats.size() - 6);
+  CHECK(usage.find((char)DEBUG_LOG_SYNC) == std::string::npos);
+  CHECK(stats.find((char)DEBUG_LOG_SYNC) == std::string::npos);
+  CHECK(sim_serial_out.find(usage) + usage.size() <= sim_serial_out.find(stats));
+
+  // The queued log records were sent before the exports.
+  CHECK(sim_serial_out.find((char)DEBUG_LOG_SYNC) < sim_serial_out.find(usage));
+  CHECK(debug_log_dropped == 0);
+}
+
+void test_log_continues_after_export() {
+  sim_serial_in = "s";
+  sim_run(5);
+  CHECK(serial_export_active());
+
+  // Records written during the export are sent after it.
+  sim_switch(SWITCH_A, 1);
+  sim_run(DELAY_TIME + 20);
+  sim_switch(SWITCH_A, 0);
+  sim_run(1000);
+
+  std::string stats = export_text("# DAK switch stats,");
+  size_t end = sim_serial_out.find(stats) + stats.size();
+  CHECK(stats.find((char)DEBUG_LOG_SYNC) == std::string::npos);
+  CHECK(sim_serial_out.find((char)DEBUG_LOG_SYNC, end) != std::string::npos);
+  CHECK(debug_log_head == debug_log_tail && !serial_export_active());
+}
+
+int main() {
+  sim_start();
+
+  RUN_TEST(test_exports_are_not_mixed);
+  sim_serial_out.clear();
+  RUN_TEST(test_log_continues_after_export);
+
+  return sim_failures != 0;
+}
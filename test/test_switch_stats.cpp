@@ -0,0 +1,207 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    test_switch_stats.cpp - host tests of the switch statistics and the debounce tuning (debounce.ino).
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+const struct Rc SWITCH_A = B30A;
+const struct Rc SWITCH_D = B32A;
+const struct Rc SWITCH_G = B34A;
+const struct Rc SWITCH_H = B37A;
+const struct Rc SWITCH_J = B38A;
+const struct Rc SWITCH_K = B39A;
+
+// Presses the switch for press_time and then releases it for release_time (ms).
+void tap(struct Rc pos, unsigned long press_time, unsigned long release_time) {
+  sim_switch(pos, 1);
+  sim_run(press_time);
+  sim_switch(pos, 0);
+  sim_run(release_time);
+}
+
+uint16_t debounce_time(struct Rc pos) {
+  return states[pos.r][pos.c].debounce_time;
+}
+
+int line_count(const std::string &text) {
+  int n = 0;
+  for (char c : text) {
+    n += c == '\n';
+  }
+  return n;
+}
+
+void test_export_after_command() {
+  // A bounce on A.
+  sim_switch(SWITCH_A, 1);
+  sim_run(10);
+  sim_switch(SWITCH_A, 0);
+  sim_run(1);
+  sim_switch(SWITCH_A, 1);
+  sim_run(50);
+  sim_switch(SWITCH_A, 0);
+  sim_run(100);
+  struct SwitchStats *stats = &switch_stats[SWITCH_A.r][SWITCH_A.c];
+  CHECK(stats->bounces > 0);
+
+  sim_serial_out.clear();
+  sim_serial_in = "s";
+  sim_run(100);
+
+  CHECK(sim_serial_out.find("# DAK switch stats," + std::to_string(ROWS) + "," + std::to_string(COLUMNS) + "\n") == 0);
+  CHECK(line_count(sim_serial_out) == ROWS * COLUMNS + 2);
+  CHECK(sim_serial_out.find("\n# end\n") == sim_serial_out.size() - 7);
+
+  std::string line = sim_format("\n%ld,%ld,%ld,", SWITCH_A.r, SWITCH_A.c, states[SWITCH_A.r][SWITCH_A.c].debounce_time) +
+    sim_format("%ld,%ld,%ld\n", stats->bounces, stats->bounce_max, stats->chatters);
+  CHECK(sim_serial_out.find(line) != std::string::npos);
+}
+
+void test_export_waits_for_room() {
+  sim_serial_out.clear();
+  sim_serial_space = SERIAL_LINE_MAX - 1;
+  sim_serial_in = "s";
+  sim_run(100);
+  CHECK(sim_serial_out.empty());
+
+  sim_serial_space = SERIAL_LINE_MAX;
+  sim_run(100);
+  CHECK(line_count(sim_serial_out) == ROWS * COLUMNS + 2);
+  sim_serial_space = 64;
+}
+
+void test_fast_double_letter_is_not_chatter() {
+  // Release of 25 ms between two presses, e.g., "dd" typed fast.
+  uint16_t window = debounce_time(SWITCH_D);
+  tap(SWITCH_D, 50, 25);
+  tap(SWITCH_D, 50, 100);
+
+  CHECK(switch_stats[SWITCH_D.r][SWITCH_D.c].chatters == 0);
+  CHECK(debounce_time(SWITCH_D) == window);
+}
+
+void test_chatter_doubles_the_window() {
+  // A release a bit longer than the debounce time gets through.
+  uint16_t window = debounce_time(SWITCH_G);
+  CHECK(window == DELAY_TIME_BOUNCE);
+  tap(SWITCH_G, 50, window / 10 + 2);
+  tap(SWITCH_G, 50, 100);
+
+  CHECK(switch_stats[SWITCH_G.r][SWITCH_G.c].chatters == 1);
+  CHECK(debounce_time(SWITCH_G) == 2 * window);
+}
+
+void test_bounce_raises_the_window() {
+  // A bounce of 4 ms is filtered by the 6 ms window, the window is raised to at least twice the bounce.
+  uint16_t window = debounce_time(SWITCH_H);
+  sim_switch(SWITCH_H, 1);
+  sim_run(10);
+  sim_switch(SWITCH_H, 0);
+  sim_run(4);
+  sim_switch(SWITCH_H, 1);
+  sim_run(50);
+  sim_switch(SWITCH_H, 0);
+  sim_run(100);
+
+  struct SwitchStats *stats = &switch_stats[SWITCH_H.r][SWITCH_H.c];
+  CHECK(stats->bounces == 1 && stats->chatters == 0);
+  CHECK(stats->bounce_max >= 35 && stats->bounce_max <= 45);
+  CHECK(debounce_time(SWITCH_H) > window);
+  CHECK(debounce_time(SWITCH_H) >= 2 * stats->bounce_max);
+  CHECK(debounce_time(SWITCH_H) < 2 * stats->bounce_max + BOUNCE_TIME_STEP);
+}
+
+void test_clean_presses_lower_the_window() {
+  uint16_t window = debounce_time(SWITCH_J);
+
+  for (int n = 0; n < BOUNCE_TUNE_PRESSES - 1; n++) {
+    tap(SWITCH_J, 30, 50);
+  }
+  CHECK(debounce_time(SWITCH_J) == window);
+
+  tap(SWITCH_J, 30, 50);
+  CHECK(debounce_time(SWITCH_J) == window - BOUNCE_TIME_STEP);
+
+  // Down to BOUNCE_TIME_MIN, one step per BOUNCE_TUNE_PRESSES presses.
+  for (int n = 0; n < 10 * BOUNCE_TUNE_PRESSES; n++) {
+    tap(SWITCH_J, 30, 50);
+  }
+  CHECK(debounce_time(SWITCH_J) == BOUNCE_TIME_MIN);
+}
+
+void test_window_is_limited_to_max() {
+  for (int n = 0; n < 4; n++) {
+    tap(SWITCH_K, 50, debounce_time(SWITCH_K) / 10 + 2); // Chatter
+    tap(SWITCH_K, 50, 100);
+  }
+  CHECK(switch_stats[SWITCH_K.r][SWITCH_K.c].chatters == 4);
+  CHECK(debounce_time(SWITCH_K) == BOUNCE_TIME_MAX);
+}
+
+void test_tuning_is_saved_and_loaded() {
+  switch_stats[SWITCH_K.r][SWITCH_K.c].chatters = 300; // Saved in one byte
+
+  // Saved in sleep mode.
+  CHECK(switch_tuning_changed);
+  sim_time_us += (unsigned long)SWITCH_TUNING_SAVE_INTERVAL * 1000;
+  sim_run(1);
+  CHECK(!switch_tuning_changed);
+  CHECK(EEPROM.read(EEPROM_SWITCH_TUNING) == EEPROM_SWITCH_TUNING_MAGIC);
+
+  struct State saved_states[ROWS][COLUMNS];
+  struct SwitchStats saved_stats[ROWS][COLUMNS];
+  memcpy(saved_states, states, sizeof(states));
+  memcpy(saved_stats, switch_stats, sizeof(switch_stats));
+
+  for (uint8_t r = 0; r < ROWS; r++) {
+    for (uint8_t c = 0; c < COLUMNS; c++) {
+      states[r][c].debounce_time = 0;
+      memset(&switch_stats[r][c], 0, sizeof(struct SwitchStats));
+    }
+  }
+  load_switch_tuning();
+
+  for (uint8_t r = 0; r < ROWS; r++) {
+    for (uint8_t c = 0; c < COLUMNS; c++) {
+      CHECK(states[r][c].debounce_time == saved_states[r][c].debounce_time);
+      CHECK(switch_stats[r][c].bounces == saved_stats[r][c].bounces);
+      CHECK(switch_stats[r][c].bounce_max == saved_stats[r][c].bounce_max);
+      CHECK(switch_stats[r][c].chatters == (saved_stats[r][c].chatters > 255 ? 255 : saved_stats[r][c].chatters));
+    }
+  }
+  CHECK(debounce_time(SWITCH_K) == BOUNCE_TIME_MAX && debounce_time(SWITCH_J) == BOUNCE_TIME_MIN);
+
+  // Without a save the initial window is used.
+  EEPROM.write(EEPROM_SWITCH_TUNING, 0xFF);
+  load_switch_tuning();
+  CHECK(debounce_time(SWITCH_K) == DELAY_TIME_BOUNCE);
+}
+
+int main() {
+  sim_start();
+
+  RUN_TEST(test_export_after_command);
+  RUN_TEST(test_export_waits_for_room);
+  RUN_TEST(test_fast_double_letter_is_not_chatter);
+  RUN_TEST(test_chatter_doubles_the_window);
+  RUN_TEST(test_bounce_raises_the_window);
+  RUN_TEST(test_clean_presses_lower_the_window);
+  RUN_TEST(test_window_is_limited_to_max);
+  RUN_TEST(test_tuning_is_saved_and_loaded);
+
+  return sim_failures != 0;
+}
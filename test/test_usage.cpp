@@ -0,0 +1,187 @@
+/*
+    DAK - is a firmware for Double Action Keyboards
+    test_usage.cpp - host tests of the usage counters (usage.ino).
+
+    Copyright (C) 2022  Jaakob Lidauer
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// SKETCH_FLAGS: -DUSAGE_COUNTERS
+// Mute on the FN layer of F, a DOUBLE_ACTION key.
+// SKETCH_LAYOUT: K33 DOUBLE_ACTION,DOUBLE_ACTION,{KEY_F,KEY_9,KEY_MEDIA_MUTE,0},{0,SHIFT,0,0},B33A,B33B
+
+const struct Rc SWITCH_A = B30A;
+const struct Rc SWITCH_S = B31A;
+const struct Rc SWITCH_F = B33A;
+const struct Rc SWITCH_FN = B58A;
+
+// Keys that fill the 6 places of the keyboard report.
+const struct Rc SWITCHES_6[6] = {B30A, B31A, B32A, B34A, B35A, B36A};
+
+void tap(struct Rc pos, int times) {
+  for (int n = 0; n < times; n++) {
+    sim_switch(pos, 1);
+    sim_run(DELAY_TIME + 20);
+    sim_switch(pos, 0);
+    sim_run(50);
+  }
+}
+
+// Index of the key in keys_const.
+int key_index(struct Rc pos) {
+  for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+    if (keys_const[i].first_switch_pos.r == pos.r && keys_const[i].first_switch_pos.c == pos.c) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+uint32_t usage_total() {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+    for (uint8_t a = 0; a < 4; a++) {
+      total += key_usage[i][a];
+    }
+  }
+  return total;
+}
+
+// Waits until the counters are saved.
+void sleep() {
+  sim_time_us += (unsigned long)USAGE_SAVE_INTERVAL * 1000;
+  sim_run(1);
+}
+
+// Starts again with the counters in the EEPROM, the size of the EEPROM is given in banks.
+void restart(int banks) {
+  EEPROM.writes_left = -1;
+  EEPROM.size = EEPROM_USAGE_COUNTERS + banks * key_usage_bank_size;
+  memset(key_usage, 0, sizeof(key_usage));
+  load_usage_counters();
+  CHECK(key_usage_banks == banks);
+}
+
+void erase_eeprom() {
+  memset(EEPROM.memory, 0xFF, sizeof(EEPROM.memory));
+}
+
+// Saves 3 presses, then 6 presses of two keys with the power lost after each byte written,
+// and checks that one of the saves (or nothing) is loaded, never a partly written bank.
+void check_power_lost_during_save(int banks, bool lost_allowed) {
+  erase_eeprom();
+  restart(banks);
+
+  tap(SWITCH_A, 3);
+  sleep();
+  tap(SWITCH_A, 2);
+  tap(SWITCH_S, 1);
+
+  uint8_t memory[sizeof(EEPROM.memory)];
+  uint32_t counts[NUMBER_OF_KEYS][4];
+  memcpy(memory, EEPROM.memory, sizeof(memory));
+  memcpy(counts, key_usage, sizeof(counts));
+  uint8_t bank = key_usage_bank;
+  uint16_t sequence = key_usage_sequence;
+
+  for (long writes = 0; ; writes++) {
+    memcpy(EEPROM.memory, memory, sizeof(memory));
+    memcpy(key_usage, counts, sizeof(counts));
+    key_usage_bank = bank;
+    key_usage_sequence = sequence;
+    last_action_time = millis();
+    sim_time_us += (unsigned long)USAGE_SAVE_INTERVAL * 1000;
+
+    EEPROM.writes_left = writes;
+    save_usage_counters();
+    bool saved = EEPROM.writes_left > 0; // The power was not lost
+
+    restart(banks);
+    uint32_t total = usage_total();
+    CHECK(total == 3 || total == 6 || (lost_allowed && total == 0));
+
+    if (saved) {
+      CHECK(total == 6);
+      break;
+    }
+  }
+}
+
+void test_counts_are_saved() {
+  erase_eeprom();
+  restart(2);
+
+  tap(SWITCH_A, 3);
+  CHECK(usage_total() == 3);
+  sleep();
+  tap(SWITCH_A, 2);
+  sleep();
+
+  restart(2);
+  CHECK(usage_total() == 5);
+}
+
+void test_power_lost_during_save_with_one_bank() {
+  check_power_lost_during_save(1, true);
+}
+
+void test_power_lost_during_save_with_two_banks() {
+  check_power_lost_during_save(2, false);
+}
+
+void test_held_double_action_key_is_counted_once() {
+  memset(key_usage, 0, sizeof(key_usage));
+  int f = key_index(SWITCH_F);
+
+  // Normal key.
+  sim_switch(SWITCH_F, 1);
+  sim_run(1000);
+  sim_switch(SWITCH_F, 0);
+  sim_run(50);
+  CHECK(key_usage[f][0] == 1);
+
+  // The keyboard report is full, F has no place.
+  for (int n = 0; n < 6; n++) {
+    sim_switch(SWITCHES_6[n], 1);
+  }
+  sim_run(DELAY_TIME + 50);
+  CHECK(sim_sent_keys[6] != 0);
+  sim_switch(SWITCH_F, 1);
+  sim_run(1000);
+  CHECK(key_usage[f][0] == 2);
+  memset(sim_switches, 0, sizeof(sim_switches));
+  sim_run(50);
+
+  // Media key on the FN layer.
+  sim_switch(SWITCH_FN, 1);
+  sim_run(50);
+  sim_switch(SWITCH_F, 1);
+  sim_run(1000);
+  CHECK(key_usage[f][2] == 1);
+  memset(sim_switches, 0, sizeof(sim_switches));
+  sim_run(50);
+  CHECK(usage_total() == 2 + 6 + 1);
+}
+
+int main() {
+  sim_start();
+
+  RUN_TEST(test_counts_are_saved);
+  RUN_TEST(test_power_lost_during_save_with_one_bank);
+  RUN_TEST(test_power_lost_during_save_with_two_banks);
+  RUN_TEST(test_held_double_action_key_is_counted_once);
+
+  return sim_failures != 0;
+}
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""
+DAK - is a firmware for Double Action Keyboards
+decode_debug_log.py - decodes the binary debug log sent by the keyboard.
+
+The debug log is enabled with DEBUG_PRINT or DEBUG_PRINT_STATES_ARRAY (hw_config.h).
+
+Usage:
+    python3 decode_debug_log.py /dev/ttyACM0   (Linux/macOS, requires pyserial)
+    python3 decode_debug_log.py COM3           (Windows, requires pyserial)
+    python3 decode_debug_log.py log.bin        (a file with the raw output)
+
+Copyright (C) 2022  Jaakob Lidauer
+Licensed under the GNU General Public License v3 or later, see LICENSE.
+"""
+
+import os
+import struct
+import sys
+
+SYNC = 0xA5
+
+# Must match struct LogRecord in constants.h
+RECORD = struct.Struct("<IBBHHH")
+
+LAYERS = {0: "normal-layer", 2: "FN-layer"}
+
+
+def keys(a0, a1, a2):
+    return [k for v in (a0, a1, a2) for k in (v & 0xFF, v >> 8)]
+
+
+# Must match enum LogEvent in constants.h
+EVENTS = {
+    0: lambda arg, a0, a1, a2: "%d records dropped" % (a0 | (a1 << 16)),
+    1: lambda arg, a0, a1, a2: "switch r%d c%d %s" % (a0, a1, "pressed" if arg else "released"),
+    2: lambda arg, a0, a1, a2: "modifiers %s keys %s" % (format(arg, "08b")[::-1], " ".join("%3d" % k for k in keys(a0, a1, a2))),
+    3: lambda arg, a0, a1, a2: "media key pressed 0x%04X" % a0,
+    4: lambda arg, a0, a1, a2: "media key released 0x%04X" % a0,
+    5: lambda arg, a0, a1, a2: "layer %s" % LAYERS.get(arg, arg),
+    6: lambda arg, a0, a1, a2: "combo %d triggered" % arg,
+}
+
+
+def decode(record):
+    time, event, arg, a0, a1, a2 = RECORD.unpack(record)
+    text = EVENTS[event](arg, a0, a1, a2) if event in EVENTS else "unknown event %d (%d %d %d %d)" % (event, arg, a0, a1, a2)
+    return "%10.1f ms  %s" % (time / 1000.0, text)
+
+
+def records(read):
+    # Yields records, resynchronizes if a byte is lost.
+    buffer = b""
+    while True:
+        data = read(64)
+        if not data:
+            return
+        buffer += data
+        while True:
+            start = buffer.find(bytes([SYNC]))
+            if start < 0:
+                buffer = b""
+                break
+            if len(buffer) < start + 1 + RECORD.size:
+                buffer = buffer[start:]
+                break
+            record = buffer[start + 1:start + 1 + RECORD.size]
+            next_byte = buffer[start + 1 + RECORD.size:start + 2 + RECORD.size]
+            if (record[4] not in EVENTS) or (next_byte and next_byte[0] != SYNC):
+                buffer = buffer[start + 1:]  # Not a record boundary
+                continue
+            buffer = buffer[start + 1 + RECORD.size:]
+            yield record
+
+
+def open_input(name):
+    # Returns a function that reads bytes from the input, an empty result ends the decoding.
+    if os.path.isfile(name):
+        return open(name, "rb").read
+    import serial  # pyserial
+    port = serial.Serial(name, timeout=None)
+    return lambda size: port.read(max(1, min(size, port.in_waiting)))
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__)
+        return 1
+    read = open_input(sys.argv[1])
+    try:
+        for record in records(read):
+            print(decode(record), flush=True)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+DAK - is a firmware for Double Action Keyboards
+merge_usage.py - merges the usage counters of one or more keyboards into a heatmap.
+
+The usage counters are enabled with USAGE_COUNTERS (hw_config.h). The exports are
+added together, they must come from keyboards with the same layout.
+
+Usage:
+    python3 merge_usage.py /dev/ttyACM0 [...]   (Linux/macOS, requires pyserial)
+    python3 merge_usage.py COM3 [...]           (Windows, requires pyserial)
+    python3 merge_usage.py usage1.txt [...]     (files with saved exports)
+
+    --save FILE     Saves the export of a keyboard (one port) to a file.
+    --csv           Prints the merged counts as CSV instead of the heatmap.
+    --layout FILE   Shows the comments of the keys from a layout file, e.g., DAK/layout_config_FI.h
+
+Copyright (C) 2022  Jaakob Lidauer
+Licensed under the GNU General Public License v3 or later, see LICENSE.
+"""
+
+import os
+import re
+import sys
+
+# Order of the counts, same as keys_const[].key_code
+ACTIONS = ["1.", "2.", "FN 1.", "FN 2."]
+
+SHADES = " .:-=+*#%@"
+
+
+def read_export(name):
+    # Returns the lines of an export from a file or from a keyboard.
+    if os.path.isfile(name):
+        return open(name).read().splitlines()
+    import serial  # pyserial
+    port = serial.Serial(name, timeout=5)
+    port.reset_input_buffer()
+    port.write(b"u")
+    lines = []
+    started = False
+    while True:
+        line = port.readline()
+        if not line:
+            raise SystemExit("%s: no answer, is USAGE_COUNTERS enabled?" % name)
+        line = line.decode("ascii", "replace").strip()
+        started = started or line.startswith("# DAK usage")
+        if started:
+            lines.append(line)
+        if started and line == "# end":
+            return lines
+
+
+def parse_export(name, lines):
+    # Returns the layout id and {key: [counts]}, None if the action is not defined.
+    layout = None
+    counts = {}
+    for line in lines:
+        if line.startswith("# DAK usage,"):
+            layout = line.split(",", 1)[1]
+            continue
+        match = re.match(r"^K(\d+),([\d,]*)$", line)
+        if match:
+            fields = match.group(2).split(",")
+            counts[int(match.group(1))] = [int(f) if f else None for f in fields]
+    if layout is None or not counts:
+        raise SystemExit("%s: not a usage export" % name)
+    return layout, counts
+
+
+def merge(exports):
+    layout = None
+    total = {}
+    for name, (export_layout, counts) in exports:
+        if layout is not None and export_layout != layout:
+            raise SystemExit("%s: layout %s differs from %s, can't merge" % (name, export_layout, layout))
+        layout = export_layout
+        for key, values in counts.items():
+            merged = total.setdefault(key, [None] * len(values))
+            for a, value in enumerate(values):
+                if value is not None:
+                    merged[a] = (merged[a] or 0) + value
+    return layout, total
+
+
+def key_comments(layout_file):
+    # Comments of the key definitions, e.g., "#define K1 ... //ESC sleep"
+    comments = {}
+    for line in open(layout_file, encoding="utf-8", errors="replace"):
+        match = re.match(r"^#define K(\d+)\s.*?//\s*(.*)$", line)
+        if match:
+            comments[int(match.group(1))] = match.group(2).strip()[:24]
+    return comments
+
+
+def print_heatmap(total, comments):
+    largest = max([v for values in total.values() for v in values if v] or [1])
+    presses = sum(v for values in total.values() for v in values if v)
+
+    print("%-5s %-24s" % ("key", "") + "".join("%14s" % a for a in ACTIONS))
+    for key in sorted(total):
+        cells = ""
+        for value in total[key]:
+            if value is None:
+                cells += "%14s" % "-"
+            else:
+                shade = SHADES[(len(SHADES) - 1) * value // largest]
+                cells += "%10d %s%s " % (value, shade, shade)
+        print("K%-4d %-24s%s" % (key, comments.get(key, ""), cells))
+    print("\n%d presses" % presses)
+
+
+def print_csv(total):
+    print("key," + ",".join(ACTIONS))
+    for key in sorted(total):
+        print("K%d,%s" % (key, ",".join("" if v is None else str(v) for v in total[key])))
+
+
+def main():
+    args = sys.argv[1:]
+    csv = "--csv" in args
+    if csv:
+        args.remove("--csv")
+    save = layout_file = None
+    if "--save" in args:
+        i = args.index("--save")
+        save = args[i + 1]
+        del args[i:i + 2]
+    if "--layout" in args:
+        i = args.index("--layout")
+        layout_file = args[i + 1]
+        del args[i:i + 2]
+    if not args or (save and len(args) != 1):
+        print(__doc__)
+        return 1
+
+    exports = []
+    for name in args:
+        lines = read_export(name)
+        if save:
+            with open(save, "w") as f:
+                f.write("\n".join(lines) + "\n")
+        exports.append((name, parse_export(name, lines)))
+
+    layout, total = merge(exports)
+    if csv:
+        print_csv(total)
+    else:
+        print("layout %s, %d keyboard(s)\n" % (layout, len(exports)))
+        print_heatmap(total, key_comments(layout_file) if layout_file else {})
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())